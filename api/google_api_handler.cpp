@@ -1,5 +1,7 @@
 #include "google_api_handler.h"
 #include <iostream>
+#include <map>
+#include <stdexcept>
 #include "google_auth.h"
 #include "google_docs.h"
 #include "google_sheets.h"
@@ -9,46 +11,254 @@
 
 namespace ConfigConst = ConfigConstants;
 
-GoogleAPIHandler::GoogleAPIHandler() {
+const int MAX_MEDIA_ITEM_ATTEMPTS = 3;
+const std::string SHEET_NAME = "Sheet1";
+const int SHEET_ID = 0;
+
+GoogleAPIHandler::GoogleAPIHandler() : sheetTabsLoaded(false) {
     docId = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::GOOGLE_DOC_ID);
     sheetId = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::GOOGLE_SHEET_ID);
+
+    const std::map<std::string, SheetInsertMode> INSERT_MODES = {
+        {"append_sort", SheetInsertMode::APPEND_AND_SORT},
+        {"sorted_insert", SheetInsertMode::SORTED_INSERT}
+    };
+    const std::string insertMode = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::SHEETS, ConfigConst::INSERT_MODE);
+    if (!INSERT_MODES.count(insertMode)) {
+        throw std::runtime_error("Invalid sheet insert mode: " + insertMode);
+    }
+    sheetInsertMode = INSERT_MODES.at(insertMode);
+
+    const std::map<std::string, SheetShard> SHARDS = {
+        {"none", SheetShard::NONE},
+        {"year", SheetShard::YEAR},
+        {"month", SheetShard::MONTH}
+    };
+    const std::string shardBy = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::SHEETS, ConfigConst::SHARD_BY);
+    if (!SHARDS.count(shardBy)) {
+        throw std::runtime_error("Invalid sheet shard: " + shardBy);
+    }
+    sheetShard = SHARDS.at(shardBy);
+
+    // Without sharding every row goes to the first tab, so there is nothing to look up
+    if (sheetShard == SheetShard::NONE) {
+        sheetTabs[SHEET_NAME] = SHEET_ID;
+    }
 };
 
 std::string GoogleAPIHandler::getDoc() {
-    authenticate();
+    const std::string accessToken = authenticate();
     return GoogleDocsAPI::getDocFile(docId, accessToken);
 }
 
 std::string GoogleAPIHandler::uploadPhoto(const std::string& projectPath, std::string& filename, const std::string& description) {
-    authenticate();
+    const std::string accessToken = authenticate();
 
     const std::string uploadToken = GooglePhotosAPI::uploadImage(accessToken, projectPath, filename);
-    if (!uploadToken.empty()) {
-        const std::string photosId = GooglePhotosAPI::createMediaItem(accessToken, uploadToken, filename, description);
-        if (photosId.size() > 0) {
-            std::cout << "Successfully uploaded image: " << filename << std::endl;
+    return createMediaItem(uploadToken, filename, description);
+}
+
+std::string GoogleAPIHandler::uploadPhotoData(const std::string& imageData, const std::string& filename, const std::string& description) {
+    const std::string accessToken = authenticate();
+
+    const std::string uploadToken = GooglePhotosAPI::uploadImageData(accessToken, imageData);
+    return createMediaItem(uploadToken, filename, description);
+}
+
+std::future<std::string> GoogleAPIHandler::startPhotoUpload(std::shared_ptr<const std::string> imageData) {
+    const std::string accessToken = authenticate();
+    return GooglePhotosAPI::uploadImageDataAsync(accessToken, std::move(imageData));
+}
+
+std::future<std::string> GoogleAPIHandler::startPhotoFileUpload(const std::string& filePath) {
+    const std::string accessToken = authenticate();
+    return GooglePhotosAPI::uploadImageFileAsync(accessToken, filePath);
+}
+
+// Creates media items in batches and retries only the items that are safe to send again.
+// Returns one id per item, left empty for items that never succeeded.
+std::vector<std::string> GoogleAPIHandler::finishPhotoUploads(const std::vector<GooglePhotosAPI::NewMediaItem>& items) {
+    std::vector<std::string> photosIds(items.size());
+
+    std::vector<size_t> remaining;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (!items.at(i).uploadToken.empty()) {
+            remaining.push_back(i);
+        } else {
+            std::cerr << "Failed to upload image: " << items.at(i).filename << std::endl;
         }
+    }
+
+    for (int attempt = 0; attempt < MAX_MEDIA_ITEM_ATTEMPTS && !remaining.empty(); attempt++) {
+        std::vector<GooglePhotosAPI::NewMediaItem> batch;
+        for (size_t index : remaining) {
+            batch.push_back(items.at(index));
+        }
+
+        const std::string accessToken = authenticate();
+        std::vector<GooglePhotosAPI::MediaItemResult> results = GooglePhotosAPI::createMediaItems(accessToken, batch);
 
-        return photosId;
+        std::vector<size_t> failed;
+        for (size_t i = 0; i < remaining.size(); i++) {
+            const GooglePhotosAPI::MediaItemResult& result = results.at(i);
+            if (!result.id.empty()) {
+                photosIds.at(remaining.at(i)) = result.id;
+                std::cout << "Successfully uploaded image: " << items.at(remaining.at(i)).filename << std::endl;
+            } else if (result.retryable) {
+                failed.push_back(remaining.at(i));
+            } else {
+                // The call may have created it anyway, so sending it again could make a duplicate
+                std::cerr << "Not retrying media item for: " << items.at(remaining.at(i)).filename << std::endl;
+            }
+        }
+        remaining = failed;
     }
-    
-    else {
-        std::cerr << "Failed to upload image." << std::endl;
-        return "";
+
+    for (size_t index : remaining) {
+        std::cerr << "Giving up on creating media item for: " << items.at(index).filename << std::endl;
     }
+
+    return photosIds;
 }
 
 void GoogleAPIHandler::appendRowsToSheet(const std::vector<std::vector<std::string>>& rowData) {
-    authenticate();
+    const std::string accessToken = authenticate();
+
+    const std::map<std::string, SheetRows> shards = groupRowsByShard(rowData);
+    ensureSheetTabs(accessToken, shards);
+
+    // A shard whose tab could not be created does not hold up the others
+    for (const auto& shard : shards) {
+        auto tab = sheetTabs.find(shard.first);
+        if (tab == sheetTabs.end()) {
+            std::cerr << "No sheet tab " << shard.first << "; " << shard.second.size() << " rows were not written." << std::endl;
+            continue;
+        }
+        writeRows(accessToken, {tab->second, tab->first}, shard.second);
+    }
+}
+
+// Names each row's tab after the year or month of its UTC datetime
+std::map<std::string, GoogleAPIHandler::SheetRows> GoogleAPIHandler::groupRowsByShard(const SheetRows& rowData) const {
+    const size_t YEAR_LENGTH = 4;   // 2025
+    const size_t MONTH_LENGTH = 7;  // 2025-05
+
+    const size_t keyLength = (sheetShard == SheetShard::YEAR) ? YEAR_LENGTH : MONTH_LENGTH;
+    const size_t column = GoogleSheetsAPI::UTC_DATETIME_COLUMN_INDEX;
+
+    std::map<std::string, SheetRows> shards;
+    for (const std::vector<std::string>& row : rowData) {
+        if (sheetShard == SheetShard::NONE || row.size() <= column || row.at(column).size() < keyLength) {
+            shards[SHEET_NAME].push_back(row);
+        } else {
+            shards[row.at(column).substr(0, keyLength)].push_back(row);
+        }
+    }
+    return shards;
+}
 
-    GoogleSheetsAPI::appendRowsToSheet(accessToken, sheetId, rowData);
-    GoogleSheetsAPI::sortSheetByDateTime(accessToken, sheetId);
+// Lists the spreadsheet's tabs along with the header row that new tabs start with
+bool GoogleAPIHandler::loadSheetTabs(const std::string& accessToken) {
+    std::vector<GoogleSheetsAPI::SheetTab> tabs;
+    if (!GoogleSheetsAPI::getSheetTabs(accessToken, sheetId, tabs) || tabs.empty()) {
+        return false;
+    }
+
+    for (const GoogleSheetsAPI::SheetTab& tab : tabs) {
+        sheetTabs[tab.title] = tab.sheetId;
+    }
 
-    std::cout << "Successfully appended " << rowData.size() << " rows to Google Sheet." << std::endl;
+    if (!GoogleSheetsAPI::getRowValues(accessToken, sheetId, tabs.front().title, 1, sheetHeader)) {
+        return false;
+    }
+    sheetTabsLoaded = true;
+    return true;
 }
 
-void GoogleAPIHandler::authenticate() {
-    if (accessToken.empty()) {
-        accessToken = GoogleAuth::getInstance().getAccessToken();
+// Creates any tab that does not exist yet, starting it with the first tab's header row.
+// Shards whose tab still does not exist afterwards are left out of sheetTabs.
+void GoogleAPIHandler::ensureSheetTabs(const std::string& accessToken, const std::map<std::string, SheetRows>& shards) {
+    auto hasMissingTab = [&]() {
+        for (const auto& shard : shards) {
+            if (!sheetTabs.count(shard.first)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (!hasMissingTab()) {
+        return;
+    }
+
+    if (!sheetTabsLoaded && (!loadSheetTabs(accessToken) || !hasMissingTab())) {
+        return;
+    }
+
+    std::vector<std::string> newTitles;
+    for (const auto& shard : shards) {
+        if (!sheetTabs.count(shard.first)) {
+            newTitles.push_back(shard.first);
+        }
+    }
+
+    std::vector<GoogleSheetsAPI::SheetTab> newTabs;
+    if (!GoogleSheetsAPI::addSheetTabs(accessToken, sheetId, newTitles, sheetHeader, newTabs)) {
+        // The tabs may have been created even though the response was lost, so list them again
+        sheetTabsLoaded = false;
+        loadSheetTabs(accessToken);
+        return;
+    }
+
+    for (const GoogleSheetsAPI::SheetTab& tab : newTabs) {
+        sheetTabs[tab.title] = tab.sheetId;
+        // A new tab has no rows to read back
+        sheetIndexes[tab.title] = SheetIndex();
+        std::cout << "Created sheet tab: " << tab.title << std::endl;
     }
+}
+
+void GoogleAPIHandler::writeRows(const std::string& accessToken, const GoogleSheetsAPI::SheetTab& tab, const SheetRows& rowData) {
+    if (sheetInsertMode == SheetInsertMode::SORTED_INSERT) {
+        insertRowsSorted(accessToken, tab, rowData);
+        return;
+    }
+
+    GoogleSheetsAPI::appendRowsToSheet(accessToken, sheetId, tab.title, rowData);
+    GoogleSheetsAPI::sortSheetByDateTime(accessToken, sheetId, tab.sheetId);
+
+    std::cout << "Successfully appended " << rowData.size() << " rows to Google Sheet tab " << tab.title << "." << std::endl;
+}
+
+// Puts each row straight into its sorted position, so the cost follows the batch rather than the whole sheet
+void GoogleAPIHandler::insertRowsSorted(const std::string& accessToken, const GoogleSheetsAPI::SheetTab& tab, const SheetRows& rowData) {
+    auto index = sheetIndexes.find(tab.title);
+    if (index == sheetIndexes.end()) {
+        std::vector<std::string> keys;
+        if (!GoogleSheetsAPI::getColumnValues(accessToken, sheetId, tab.title, GoogleSheetsAPI::UTC_DATETIME_COLUMN_INDEX, keys)) {
+            std::cerr << "Could not read the datetimes in " << tab.title << "; appending and sorting instead." << std::endl;
+            GoogleSheetsAPI::appendRowsToSheet(accessToken, sheetId, tab.title, rowData);
+            GoogleSheetsAPI::sortSheetByDateTime(accessToken, sheetId, tab.sheetId);
+            return;
+        }
+        index = sheetIndexes.emplace(tab.title, SheetIndex(std::move(keys))).first;
+    }
+
+    std::vector<GoogleSheetsAPI::RowBlock> blocks = index->second.place(rowData, GoogleSheetsAPI::UTC_DATETIME_COLUMN_INDEX);
+    if (!GoogleSheetsAPI::insertRows(accessToken, sheetId, tab.sheetId, blocks)) {
+        // The index no longer matches the sheet, so it is read again next time
+        sheetIndexes.erase(index);
+        return;
+    }
+
+    std::cout << "Successfully inserted " << rowData.size() << " rows into Google Sheet tab " << tab.title << "." << std::endl;
+}
+
+std::string GoogleAPIHandler::createMediaItem(const std::string& uploadToken, const std::string& filename, const std::string& description) {
+    return finishPhotoUploads({{uploadToken, filename, description}}).front();
+}
+
+// Asked for on every call so a token refreshed mid-run is picked up
+std::string GoogleAPIHandler::authenticate() {
+    return GoogleAuth::getInstance().getAccessToken();
 }
\ No newline at end of file
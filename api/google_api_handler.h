@@ -1,23 +1,60 @@
 #ifndef GOOGLE_API_HANDLER_H
 #define GOOGLE_API_HANDLER_H
 
+#include <future>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
+#include "google_photos.h"
+#include "sheet_index.h"
 
+// Upload methods may be called from several threads at once; GoogleAuth hands each the current access token.
 class GoogleAPIHandler {
 public:
     GoogleAPIHandler();
     std::string getDoc();
     std::string uploadPhoto(const std::string& projectPath, std::string& filename, const std::string& description);
+    std::string uploadPhotoData(const std::string& imageData, const std::string& filename, const std::string& description);
+    // Starts the byte upload without waiting; finishPhotoUploads turns the resulting tokens into media items
+    std::future<std::string> startPhotoUpload(std::shared_ptr<const std::string> imageData);
+    std::future<std::string> startPhotoFileUpload(const std::string& filePath);
+    std::vector<std::string> finishPhotoUploads(const std::vector<GooglePhotosAPI::NewMediaItem>& items);
     void appendRowsToSheet(const std::vector<std::vector<std::string>>& rowData);
 
 private:
-    void authenticate();
+    enum class SheetInsertMode {
+        APPEND_AND_SORT,
+        SORTED_INSERT
+    };
+
+    enum class SheetShard {
+        NONE,
+        YEAR,
+        MONTH
+    };
+
+    using SheetRows = std::vector<std::vector<std::string>>;
+
+    std::map<std::string, SheetRows> groupRowsByShard(const SheetRows& rowData) const;
+    bool loadSheetTabs(const std::string& accessToken);
+    void ensureSheetTabs(const std::string& accessToken, const std::map<std::string, SheetRows>& shards);
+    void writeRows(const std::string& accessToken, const GoogleSheetsAPI::SheetTab& tab, const SheetRows& rowData);
+    void insertRowsSorted(const std::string& accessToken, const GoogleSheetsAPI::SheetTab& tab, const SheetRows& rowData);
+    std::string createMediaItem(const std::string& uploadToken, const std::string& filename, const std::string& description);
+    std::string authenticate();
 
 private:
-    std::string accessToken;
     std::string docId;
     std::string sheetId;
+    SheetInsertMode sheetInsertMode;
+    SheetShard sheetShard;
+    // Tab ids by title; when sharding, listed from the spreadsheet on first use along with the header row
+    std::map<std::string, int> sheetTabs;
+    bool sheetTabsLoaded;
+    std::vector<std::string> sheetHeader;
+    // One per tab, loaded from the sheet on first use and then kept in step with every insert
+    std::map<std::string, SheetIndex> sheetIndexes;
     
 };
 
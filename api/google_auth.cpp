@@ -1,27 +1,65 @@
 #include "google_auth.h"
 #include <iostream>
-#include <curl/curl.h>
+#include "request_scheduler.h"
 #include "../config/config_handler.h"
-#include "../utils/web_utils.h"
 
 namespace ConfigConst = ConfigConstants;
 
+const std::string TOKEN_URL = "https://oauth2.googleapis.com/token";
+// A token this close to expiring is refreshed rather than handed out
+const std::chrono::minutes TOKEN_REFRESH_MARGIN(5);
+const std::chrono::seconds REFRESH_RETRY_DELAY(30);
+
 GoogleAuth& GoogleAuth::getInstance() {
     static GoogleAuth instance;
     return instance;
 }
 
 std::string GoogleAuth::getAccessToken() {
-    if (accessToken.empty()) {
-        accessToken = getNewAccessToken();
+    std::shared_ptr<const AccessToken> token = std::atomic_load(&accessToken);
+    if (isUsable(token)) {
+        return token->value;
     }
 
-    return accessToken;
+    return refreshAccessToken(token ? token->value : "").get();
+}
+
+std::shared_future<std::string> GoogleAuth::refreshAccessToken(const std::string& rejectedToken) {
+    std::lock_guard<std::mutex> lock(refreshMutex);
+
+    std::shared_ptr<const AccessToken> token = std::atomic_load(&accessToken);
+    if (isUsable(token) && token->value != rejectedToken) {
+        std::promise<std::string> current;
+        current.set_value(token->value);
+        return current.get_future().share();
+    }
+
+    if (refreshInFlight.valid() && refreshInFlight.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return refreshInFlight;
+    }
+
+    refreshInFlight = std::async(std::launch::async, &GoogleAuth::requestAccessToken, this).share();
+    return refreshInFlight;
 }
 
 GoogleAuth::GoogleAuth() {
     clientId = ConfigHandler::getInstance().getConfigValue(ConfigConst::GOOGLE_AUTH, ConfigConst::CLIENT_ID);
     clientSecret = ConfigHandler::getInstance().getConfigValue(ConfigConst::GOOGLE_AUTH, ConfigConst::CLIENT_SECRET);
+
+    // Created first so it is destroyed after the refresh thread has stopped
+    RequestScheduler::getInstance();
+    loadAccessToken();
+
+    refreshThread = std::thread(&GoogleAuth::refreshLoop, this);
+}
+
+GoogleAuth::~GoogleAuth() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopCondition.notify_all();
+    refreshThread.join();
 }
 
 void GoogleAuth::openAuthenticationPage() {
@@ -95,27 +133,26 @@ void GoogleAuth::getNewRefreshToken() {
 
     getAuthorizationCode();
 
-    std::string command = "curl -X POST \"https://oauth2.googleapis.com/token\" "
-                        "-H \"Content-Type: application/x-www-form-urlencoded\" "
-                        "-d \"code=" + authorizationCode +
+    HttpRequest request;
+    request.method = "POST";
+    request.url = TOKEN_URL;
+    request.headers.push_back("Content-Type: application/x-www-form-urlencoded");
+    const std::string postFields = "code=" + authorizationCode +
                         "&client_id=" + clientId +
                         "&client_secret=" + clientSecret +
                         "&redirect_uri=" + redirectUri +
-                        "&grant_type=authorization_code\"";
+                        "&grant_type=authorization_code";
+    request.body = postFields;
 
-    std::string response;
-    char buffer[128];
-    FILE *pipe = popen(command.c_str(), "r");
-    if (!pipe) {
-        std::cerr << "Error running cURL command!" << std::endl;
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::OAUTH, request);
+    if (!response.succeeded()) {
+        std::cerr << "Refresh token request failed: " << response.describeFailure() << std::endl;
+        return;
     }
 
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        response += buffer;
-    }
-    pclose(pipe);
-
-    saveRefreshToken(response);
+    saveRefreshToken(response.body);
+    // The authorization code exchange returns an access token as well
+    saveAccessToken(response.body);
 }
 
 void GoogleAuth::saveRefreshToken(const std::string& response) {
@@ -135,37 +172,102 @@ void GoogleAuth::getRefreshToken() {
     }
 }
 
-std::string GoogleAuth::getNewAccessToken() {
+// Runs as the single in-flight refresh
+std::string GoogleAuth::requestAccessToken() {
     if (refreshToken.empty()) {
+        std::shared_ptr<const AccessToken> before = std::atomic_load(&accessToken);
         getRefreshToken();
-    }
 
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "Failed to initialize cURL." << std::endl;
-        return "";
+        // Signing in already produced a new access token
+        std::shared_ptr<const AccessToken> after = std::atomic_load(&accessToken);
+        if (after != before && isUsable(after)) {
+            return after->value;
+        }
     }
 
-    std::string response;
     std::string postFields = "client_id=" + clientId +
                         "&client_secret=" + clientSecret +
                         "&refresh_token=" + refreshToken +
                         "&grant_type=refresh_token";
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://oauth2.googleapis.com/token");
-    curl_easy_setopt(curl, CURLOPT_POST, 1);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postFields.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WebUtils::writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    HttpRequest request;
+    request.method = "POST";
+    request.url = TOKEN_URL;
+    request.body = postFields;
 
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::OAUTH, request);
 
-    if (res != CURLE_OK) {
-        std::cerr << "cURL request failed: " << curl_easy_strerror(res) << std::endl;
+    if (!response.succeeded()) {
+        std::cerr << "Access token request failed: " << response.describeFailure() << std::endl;
         return "";
     }
 
+    return saveAccessToken(response.body);
+}
+
+std::string GoogleAuth::saveAccessToken(const std::string& response) {
     nlohmann::json jsonResponse = nlohmann::json::parse(response);
-    return jsonResponse["access_token"];
+    if (!jsonResponse.contains("access_token") || !jsonResponse.contains("expires_in")) {
+        std::cerr << "Access token missing from response: " << response << std::endl;
+        return "";
+    }
+
+    std::shared_ptr<AccessToken> token = std::make_shared<AccessToken>();
+    token->value = jsonResponse["access_token"];
+    token->expiry = Clock::now() + std::chrono::seconds(jsonResponse["expires_in"].get<long long>());
+    std::atomic_store(&accessToken, std::shared_ptr<const AccessToken>(token));
+
+    // Stored as a string of Unix seconds since config values are only ever set as strings
+    const long long expiry = std::chrono::duration_cast<std::chrono::seconds>(token->expiry.time_since_epoch()).count();
+    ConfigHandler::getInstance().setConfigValues(ConfigConst::GOOGLE_AUTH, {
+        { ConfigConst::ACCESS_TOKEN, token->value },
+        { ConfigConst::ACCESS_TOKEN_EXPIRY, std::to_string(expiry) }
+    });
+    return token->value;
+}
+
+// Picks up the token saved by an earlier run; an expired one is refreshed on first use
+void GoogleAuth::loadAccessToken() {
+    std::shared_ptr<AccessToken> token = std::make_shared<AccessToken>();
+    try {
+        token->value = ConfigHandler::getInstance().getConfigValue(ConfigConst::GOOGLE_AUTH, ConfigConst::ACCESS_TOKEN);
+        const long long expiry = std::stoll(ConfigHandler::getInstance().getConfigValue(ConfigConst::GOOGLE_AUTH, ConfigConst::ACCESS_TOKEN_EXPIRY).get<std::string>());
+        token->expiry = Clock::time_point(std::chrono::seconds(expiry));
+    } catch (const std::exception& e) {
+        return;
+    }
+
+    if (isUsable(token)) {
+        std::cout << "Reusing cached access token." << std::endl;
+        std::atomic_store(&accessToken, std::shared_ptr<const AccessToken>(token));
+    }
+}
+
+bool GoogleAuth::isUsable(const std::shared_ptr<const AccessToken>& token) {
+    return token && !token->value.empty() && Clock::now() + TOKEN_REFRESH_MARGIN < token->expiry;
+}
+
+// Refreshes the token shortly before it expires so long runs never send a stale one
+void GoogleAuth::refreshLoop() {
+    std::unique_lock<std::mutex> lock(stopMutex);
+    while (!stopping) {
+        // Nothing to refresh until the first token has been handed out
+        std::shared_ptr<const AccessToken> token = std::atomic_load(&accessToken);
+        if (!token) {
+            stopCondition.wait_for(lock, REFRESH_RETRY_DELAY, [this] { return stopping; });
+            continue;
+        }
+
+        if (stopCondition.wait_until(lock, token->expiry - TOKEN_REFRESH_MARGIN, [this] { return stopping; })) {
+            break;
+        }
+
+        lock.unlock();
+        const bool refreshed = !refreshAccessToken(token->value).get().empty();
+        lock.lock();
+
+        if (!refreshed) {
+            stopCondition.wait_for(lock, REFRESH_RETRY_DELAY, [this] { return stopping; });
+        }
+    }
 }
@@ -1,7 +1,13 @@
 #ifndef GOOGLE_AUTH_H
 #define GOOGLE_AUTH_H
 
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 
@@ -10,10 +16,16 @@ namespace beast = boost::beast;
 namespace http = beast::http;
 using tcp = asio::ip::tcp;
 
+// The access token is cached in the config with its expiry and refreshed in the background before it runs out.
+// Any number of threads may read it without locking; concurrent refreshes share one in-flight request.
 class GoogleAuth {
 public:
     static GoogleAuth& getInstance();
     std::string getAccessToken();
+    // Replaces a token the server rejected. Resolves to the current token if another thread already
+    // replaced it, and to an empty string if the refresh failed.
+    std::shared_future<std::string> refreshAccessToken(const std::string& rejectedToken);
+    ~GoogleAuth();
 
 private:
     GoogleAuth();
@@ -28,16 +40,37 @@ private:
     void getNewRefreshToken();
     void saveRefreshToken(const std::string& response);
     void getRefreshToken();
-    std::string getNewAccessToken();
+    std::string requestAccessToken();
+    std::string saveAccessToken(const std::string& response);
+    void loadAccessToken();
+    void refreshLoop();
 
 private:
+    using Clock = std::chrono::system_clock;
+
+    struct AccessToken {
+        std::string value;
+        Clock::time_point expiry;
+    };
+
+    static bool isUsable(const std::shared_ptr<const AccessToken>& token);
+
     std::string clientId;
     std::string clientSecret;
     std::string authorizationCode;
     std::string refreshToken;
-    std::string accessToken;
     std::string redirectUri;
 
+    // Only read and written through std::atomic_load and std::atomic_store
+    std::shared_ptr<const AccessToken> accessToken;
+    std::mutex refreshMutex;
+    std::shared_future<std::string> refreshInFlight;
+
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    std::thread refreshThread;
+    bool stopping = false;
+
 };
 
 #endif // GOOGLE_AUTH_H
@@ -1,98 +1,220 @@
 #include "google_photos.h"
-#include <curl/curl.h>
+#include <algorithm>
+#include <filesystem>
 #include <stdexcept>
 #include <iostream>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
-#include "../utils/web_utils.h"
-#include "../utils/file_utils.h"
+#include "google_auth.h"
+#include "request_scheduler.h"
+#include "resumable_upload.h"
+#include "upload_engine.h"
+#include "../config/config_handler.h"
 
-std::string GooglePhotosAPI::uploadImage(const std::string& accessToken, const std::string& imagePath, const std::string& filename) {
-    CURL* curl;
-    CURLcode res;
-    std::string response;
-    
-    curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "CURL initialization failed!" << std::endl;
+namespace ConfigConst = ConfigConstants;
+
+const uint64_t BYTES_PER_KB = 1024;
+
+struct UploadSettings {
+    std::string url;
+    uint64_t resumableThreshold;
+    uint64_t resumableChunkSize;
+    int maxResumeAttempts;
+};
+
+static UploadSettings loadUploadSettings() {
+    ConfigHandler& config = ConfigHandler::getInstance();
+
+    UploadSettings settings;
+    settings.url = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::UPLOADS, ConfigConst::UPLOAD_URL);
+    settings.resumableThreshold = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::UPLOADS, ConfigConst::RESUMABLE_THRESHOLD_KB).get<uint64_t>() * BYTES_PER_KB;
+    settings.resumableChunkSize = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::UPLOADS, ConfigConst::RESUMABLE_CHUNK_KB).get<uint64_t>() * BYTES_PER_KB;
+    settings.maxResumeAttempts = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::UPLOADS, ConfigConst::MAX_RESUME_ATTEMPTS);
+    return settings;
+}
+
+static const UploadSettings& getUploadSettings() {
+    static const UploadSettings settings = loadUploadSettings();
+    return settings;
+}
+
+// Large images are sent in resumable chunks so a dropped connection only costs the current chunk
+static bool isResumable(uint64_t size) {
+    return size >= getUploadSettings().resumableThreshold;
+}
+
+static std::string uploadResumable(const ResumableUpload::Source& source) {
+    const UploadSettings& settings = getUploadSettings();
+    ResumableUpload::TokenProvider getAccessToken = []() {
+        return GoogleAuth::getInstance().getAccessToken();
+    };
+    return ResumableUpload::upload(getAccessToken, settings.url, source, settings.resumableChunkSize, settings.maxResumeAttempts);
+}
+
+static HttpRequest buildUploadRequest(const std::string& accessToken) {
+    HttpRequest request;
+    request.method = "POST";
+    request.url = getUploadSettings().url;
+    request.headers.push_back("Authorization: Bearer " + accessToken);
+    request.headers.push_back("Content-Type: application/octet-stream");
+    request.headers.push_back("X-Goog-Upload-Protocol: raw");
+    return request;
+}
+
+static std::string getUploadToken(const HttpResponse& response) {
+    if (!response.succeeded()) {
+        std::cerr << "Image upload failed: " << response.describeFailure() << std::endl;
         return "";
     }
 
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, ("Authorization: Bearer " + accessToken).c_str());
-    headers = curl_slist_append(headers, "Content-Type: application/octet-stream");
-    headers = curl_slist_append(headers, "X-Goog-Upload-Protocol: raw");
+    return response.body;
+}
 
-    std::optional<std::string> fileDataOpt = FileUtils::readFile(imagePath, filename);
-    if (!fileDataOpt.has_value()) {
-        curl_easy_cleanup(curl);
-        return "";
+// imageData keeps an in-memory body alive until the engine has finished sending it
+static std::future<std::string> submitUpload(const HttpRequest& request, std::shared_ptr<const std::string> imageData) {
+    std::shared_ptr<std::promise<std::string>> uploadToken = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = uploadToken->get_future();
+
+    UploadEngine::getInstance().submit(RequestScheduler::PHOTOS, request, [uploadToken, imageData](HttpResponse& response) mutable {
+        imageData.reset();
+        uploadToken->set_value(getUploadToken(response));
+    });
+
+    return future;
+}
+
+static uint64_t getFileSize(const std::string& filePath) {
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(filePath, error);
+    return error ? 0 : static_cast<uint64_t>(size);
+}
+
+std::string GooglePhotosAPI::uploadImage(const std::string& accessToken, const std::string& imagePath, const std::string& filename) {
+    const std::string filePath = imagePath + filename;
+    const uint64_t size = getFileSize(filePath);
+    if (isResumable(size)) {
+        return uploadResumable({"", filePath, size});
     }
-    std::string fileData = fileDataOpt.value();
-    
-    curl_easy_setopt(curl, CURLOPT_URL, "https://photoslibrary.googleapis.com/v1/uploads");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POST, 1);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, fileData.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, fileData.size());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WebUtils::writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK) {
-        std::cerr << "Image upload failed: " << curl_easy_strerror(res) << std::endl;
-        return "";
+
+    HttpRequest request = buildUploadRequest(accessToken);
+    request.bodyFile = filePath;
+
+    return getUploadToken(RequestScheduler::getInstance().perform(RequestScheduler::PHOTOS, request));
+}
+
+std::string GooglePhotosAPI::uploadImageData(const std::string& accessToken, const std::string& imageData) {
+    if (isResumable(imageData.size())) {
+        return uploadResumable({imageData, "", imageData.size()});
     }
 
-    return response;
+    HttpRequest request = buildUploadRequest(accessToken);
+    request.body = imageData;
+
+    return getUploadToken(RequestScheduler::getInstance().perform(RequestScheduler::PHOTOS, request));
 }
 
-std::string GooglePhotosAPI::createMediaItem(const std::string& accessToken, const std::string& uploadToken, const std::string& filename, const std::string& description) {
-    CURL* curl;
-    CURLcode res;
-    std::string response;
-    
-    nlohmann::json requestBody = {
-        {"newMediaItems", {
-            {
-                {"description", description},
-                {"simpleMediaItem", {
-                    {"uploadToken", uploadToken},
-                    {"fileName", filename}
-                }}
-            }
-        }}
-    };
+// Resumable uploads wait between retries, so they get a thread of their own instead of the engine
+std::future<std::string> GooglePhotosAPI::uploadImageDataAsync(const std::string& accessToken, std::shared_ptr<const std::string> imageData) {
+    if (isResumable(imageData->size())) {
+        return std::async(std::launch::async, [imageData]() {
+            return uploadResumable({*imageData, "", imageData->size()});
+        });
+    }
 
-    curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "CURL initialization failed!" << std::endl;
-        return "";
+    HttpRequest request = buildUploadRequest(accessToken);
+    request.body = *imageData;
+
+    return submitUpload(request, std::move(imageData));
+}
+
+std::future<std::string> GooglePhotosAPI::uploadImageFileAsync(const std::string& accessToken, const std::string& filePath) {
+    const uint64_t size = getFileSize(filePath);
+    if (isResumable(size)) {
+        return std::async(std::launch::async, [filePath, size]() {
+            return uploadResumable({"", filePath, size});
+        });
     }
 
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, ("Authorization: Bearer " + accessToken).c_str());
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    HttpRequest request = buildUploadRequest(accessToken);
+    request.bodyFile = filePath;
+
+    return submitUpload(request, nullptr);
+}
+
+// Fills in the results of one batchCreate call's items, matching results to items by upload token
+static void createMediaItemBatch(const std::string& accessToken, const std::vector<GooglePhotosAPI::NewMediaItem>& items, size_t first, size_t count, std::vector<GooglePhotosAPI::MediaItemResult>& results) {
+    nlohmann::json newMediaItems = nlohmann::json::array();
+    std::unordered_map<std::string, size_t> itemIndexes;
+    for (size_t i = first; i < first + count; i++) {
+        const GooglePhotosAPI::NewMediaItem& item = items.at(i);
+        newMediaItems.push_back({
+            {"description", item.description},
+            {"simpleMediaItem", {
+                {"uploadToken", item.uploadToken},
+                {"fileName", item.filename}
+            }}
+        });
+        itemIndexes[item.uploadToken] = i;
+    }
 
+    nlohmann::json requestBody = {{"newMediaItems", newMediaItems}};
     std::string postData = requestBody.dump();
 
-    curl_easy_setopt(curl, CURLOPT_URL, "https://photoslibrary.googleapis.com/v1/mediaItems:batchCreate");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POST, 1);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postData.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WebUtils::writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    HttpRequest request;
+    request.method = "POST";
+    request.url = "https://photoslibrary.googleapis.com/v1/mediaItems:batchCreate";
+    request.headers.push_back("Authorization: Bearer " + accessToken);
+    request.headers.push_back("Content-Type: application/json");
+    request.body = postData;
 
-    res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    // Sent again only when it was not processed, so a retry never creates duplicate media items
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::PHOTOS, request, RequestScheduler::RETRY_UNPROCESSED);
 
-    if (res != CURLE_OK) {
-        std::cerr << "Failed to create media item: " << curl_easy_strerror(res) << std::endl;
-        return "";
+    if (!response.succeeded()) {
+        std::cerr << "Failed to create media items: " << response.describeFailure() << std::endl;
+        // Any other failure may have come after the server created the items
+        const bool unprocessed = response.status == 429 || response.status == 503;
+        for (size_t i = first; i < first + count; i++) {
+            results.at(i).retryable = unprocessed;
+        }
+        return;
     }
 
-    auto jsonResponse = nlohmann::json::parse(response);
-    std::string photos_id = jsonResponse["newMediaItemResults"][0]["mediaItem"]["id"].get<std::string>();
-    return photos_id;
+    nlohmann::json jsonResponse = nlohmann::json::parse(response.body, nullptr, false);
+    if (jsonResponse.is_discarded() || !jsonResponse.contains("newMediaItemResults")) {
+        std::cerr << "Failed to create media items: " << response.body << std::endl;
+        return;
+    }
+
+    const nlohmann::json& itemResults = jsonResponse["newMediaItemResults"];
+    for (size_t i = 0; i < itemResults.size(); i++) {
+        const nlohmann::json& result = itemResults[i];
+
+        size_t index = first + i;
+        if (result.contains("uploadToken")) {
+            auto found = itemIndexes.find(result["uploadToken"].get<std::string>());
+            if (found == itemIndexes.end()) {
+                continue;
+            }
+            index = found->second;
+        } else if (i >= count) {
+            continue;
+        }
+
+        if (result.contains("mediaItem") && result["mediaItem"].contains("id")) {
+            results.at(index).id = result["mediaItem"]["id"].get<std::string>();
+        } else if (result.contains("status")) {
+            results.at(index).retryable = true;
+            std::cerr << "Failed to create media item " << items.at(index).filename << ": " << result["status"].value("message", "unknown error") << std::endl;
+        }
+    }
+}
+
+std::vector<GooglePhotosAPI::MediaItemResult> GooglePhotosAPI::createMediaItems(const std::string& accessToken, const std::vector<NewMediaItem>& items) {
+    std::vector<MediaItemResult> results(items.size());
+    for (size_t first = 0; first < items.size(); first += MAX_BATCH_CREATE_ITEMS) {
+        const size_t count = std::min(MAX_BATCH_CREATE_ITEMS, items.size() - first);
+        createMediaItemBatch(accessToken, items, first, count, results);
+    }
+    return results;
 }
\ No newline at end of file
@@ -1,12 +1,37 @@
 #ifndef GOOGLE_PHOTOS_H
 #define GOOGLE_PHOTOS_H
 
+#include <future>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace GooglePhotosAPI {
 
+    // The most newMediaItems the API accepts in one batchCreate call
+    const size_t MAX_BATCH_CREATE_ITEMS = 50;
+
+    struct NewMediaItem {
+        std::string uploadToken;
+        std::string filename;
+        std::string description;
+    };
+
     std::string uploadImage(const std::string& accessToken, const std::string& imagePath, const std::string& filename);
-    std::string createMediaItem(const std::string& accessToken, const std::string& uploadToken, const std::string& filename, const std::string& description);
+    std::string uploadImageData(const std::string& accessToken, const std::string& imageData);
+    // Run on the upload engine. An in-memory image is kept alive until its transfer finishes,
+    // and a file is streamed from disk rather than loaded.
+    std::future<std::string> uploadImageDataAsync(const std::string& accessToken, std::shared_ptr<const std::string> imageData);
+    std::future<std::string> uploadImageFileAsync(const std::string& accessToken, const std::string& filePath);
+    // The id is empty when the item failed. Only then does retryable say whether sending it again
+    // is safe, because the server either rejected that item alone or never acted on the call.
+    struct MediaItemResult {
+        std::string id;
+        bool retryable = false;
+    };
+
+    // Returns one result per item, in the same order
+    std::vector<MediaItemResult> createMediaItems(const std::string& accessToken, const std::vector<NewMediaItem>& items);
 
 }
 
@@ -1,63 +1,86 @@
 #include "google_sheets.h"
-#include <curl/curl.h>
+#include <algorithm>
 #include <nlohmann/json.hpp>
 #include <iostream>
-#include "../utils/web_utils.h"
+#include "request_scheduler.h"
 
-void GoogleSheetsAPI::appendRowsToSheet(const std::string& accessToken, const std::string& spreadsheetId, const std::vector<std::vector<std::string>>& rowData) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "Failed to initialize CURL.\n";
-        return;
+const std::string SHEETS_URL = "https://sheets.googleapis.com/v4/spreadsheets/";
+
+// Quoted so tab names that look like numbers, such as a year, are not read as cell references
+static std::string toRange(const std::string& sheetName, const std::string& cells) {
+    return "'" + sheetName + "'!" + cells;
+}
+
+static std::string toColumnLetter(int columnIndex) {
+    return std::string(1, static_cast<char>('A' + columnIndex));
+}
+
+static nlohmann::json toRowData(const std::vector<std::string>& row) {
+    nlohmann::json cells = nlohmann::json::array();
+    for (const std::string& cell : row) {
+        cells.push_back({ { "userEnteredValue", { { "stringValue", cell } } } });
     }
+    return { { "values", cells } };
+}
+
+static bool getValues(const std::string& accessToken, const std::string& spreadsheetId, const std::string& range, const std::string& majorDimension, std::vector<std::string>& values) {
+    HttpRequest request;
+    request.url = SHEETS_URL + spreadsheetId + "/values/" + range + "?majorDimension=" + majorDimension;
+    request.headers.push_back("Authorization: Bearer " + accessToken);
 
-    std::string response_string;
-    std::string url = "https://sheets.googleapis.com/v4/spreadsheets/" + spreadsheetId +
-                    "/values/Sheet1!A1:append?valueInputOption=RAW&insertDataOption=INSERT_ROWS";
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::SHEETS, request);
+
+    if (!response.succeeded()) {
+        std::cerr << "Failed to read " << range << ": " << response.describeFailure() << "\n";
+        return false;
+    }
+
+    values.clear();
+    nlohmann::json jsonResponse = nlohmann::json::parse(response.body);
+    // An empty range has no values at all
+    if (jsonResponse.contains("values") && !jsonResponse["values"].empty()) {
+        for (const nlohmann::json& value : jsonResponse["values"][0]) {
+            values.push_back(value.get<std::string>());
+        }
+    }
+    return true;
+}
+
+void GoogleSheetsAPI::appendRowsToSheet(const std::string& accessToken, const std::string& spreadsheetId, const std::string& sheetName, const std::vector<std::vector<std::string>>& rowData) {
+    std::string url = SHEETS_URL + spreadsheetId +
+                    "/values/" + toRange(sheetName, "A1") + ":append?valueInputOption=RAW&insertDataOption=INSERT_ROWS";
 
     nlohmann::json j;
     j["values"] = rowData;
 
     std::string postData = j.dump();
 
-    std::string bearer = "Authorization: Bearer " + accessToken;
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, bearer.c_str());
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    HttpRequest request;
+    request.method = "POST";
+    request.url = url;
+    request.headers.push_back("Authorization: Bearer " + accessToken);
+    request.headers.push_back("Content-Type: application/json");
+    request.body = postData;
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postData.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WebUtils::writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
+    // Appending again after the server already did would duplicate the rows
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::SHEETS, request, RequestScheduler::RETRY_UNPROCESSED);
 
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-
-    if (res != CURLE_OK) {
-        std::cerr << "Failed to append row: " << curl_easy_strerror(res) << "\n";
+    if (!response.succeeded()) {
+        std::cerr << "Failed to append row: " << response.describeFailure() << "\n";
     }
 }
 
 
 void GoogleSheetsAPI::sortSheetByDateTime(const std::string& accessToken, const std::string& spreadsheetId, int sheetId) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "Failed to initialize CURL.\n";
-        return;
-    }
+    std::string url = SHEETS_URL + spreadsheetId + ":batchUpdate";
 
-    std::string url = "https://sheets.googleapis.com/v4/spreadsheets/" + spreadsheetId + ":batchUpdate";
-    std::string response_string;
-
-    const int UTC_DATETIME_COLUMN_INDEX = 9;
     nlohmann::json sortRequest = {
         { "requests", {
             {
             { "sortRange", {
                 { "range", {
                     { "sheetId", sheetId },
-                    { "startRowIndex", 1 }
+                    { "startRowIndex", HEADER_ROWS }
                 }},
                 { "sortSpecs", {
                     {
@@ -72,21 +95,179 @@ void GoogleSheetsAPI::sortSheetByDateTime(const std::string& accessToken, const
 
     std::string postData = sortRequest.dump();
 
-    std::string bearer = "Authorization: Bearer " + accessToken;
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, bearer.c_str());
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    HttpRequest request;
+    request.method = "POST";
+    request.url = url;
+    request.headers.push_back("Authorization: Bearer " + accessToken);
+    request.headers.push_back("Content-Type: application/json");
+    request.body = postData;
+
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::SHEETS, request);
+
+    if (!response.succeeded()) {
+        std::cerr << "Sort request failed: " << response.describeFailure() << "\n";
+    }
+}
+
+bool GoogleSheetsAPI::getColumnValues(const std::string& accessToken, const std::string& spreadsheetId, const std::string& sheetName, int columnIndex, std::vector<std::string>& values) {
+    const std::string column = toColumnLetter(columnIndex);
+    return getValues(accessToken, spreadsheetId, toRange(sheetName, column + std::to_string(HEADER_ROWS + 1) + ":" + column), "COLUMNS", values);
+}
+
+bool GoogleSheetsAPI::getRowValues(const std::string& accessToken, const std::string& spreadsheetId, const std::string& sheetName, int rowNumber, std::vector<std::string>& values) {
+    const std::string row = std::to_string(rowNumber);
+    return getValues(accessToken, spreadsheetId, toRange(sheetName, row + ":" + row), "ROWS", values);
+}
+
+bool GoogleSheetsAPI::getSheetTabs(const std::string& accessToken, const std::string& spreadsheetId, std::vector<SheetTab>& tabs) {
+    HttpRequest request;
+    request.url = SHEETS_URL + spreadsheetId + "?fields=sheets.properties(sheetId,title,index)";
+    request.headers.push_back("Authorization: Bearer " + accessToken);
+
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::SHEETS, request);
+
+    if (!response.succeeded()) {
+        std::cerr << "Failed to list sheet tabs: " << response.describeFailure() << "\n";
+        return false;
+    }
+
+    tabs.clear();
+    nlohmann::json jsonResponse = nlohmann::json::parse(response.body);
+    for (const nlohmann::json& sheet : jsonResponse["sheets"]) {
+        tabs.push_back({ sheet["properties"]["sheetId"].get<int>(), sheet["properties"]["title"].get<std::string>() });
+    }
+    return true;
+}
+
+bool GoogleSheetsAPI::addSheetTabs(const std::string& accessToken, const std::string& spreadsheetId, const std::vector<std::string>& titles, const std::vector<std::string>& header, std::vector<SheetTab>& tabs) {
+    // Sheets picks the ids, since one chosen here could collide with or overflow past an existing tab's
+    nlohmann::json requests = nlohmann::json::array();
+    for (const std::string& title : titles) {
+        requests.push_back({
+            { "addSheet", {
+                { "properties", {
+                    { "title", title },
+                    { "gridProperties", { { "frozenRowCount", HEADER_ROWS } } }
+                }}
+            }}
+        });
+    }
+
+    nlohmann::json batchUpdate;
+    batchUpdate["requests"] = requests;
+    std::string postData = batchUpdate.dump();
+
+    HttpRequest request;
+    request.method = "POST";
+    request.url = SHEETS_URL + spreadsheetId + ":batchUpdate";
+    request.headers.push_back("Authorization: Bearer " + accessToken);
+    request.headers.push_back("Content-Type: application/json");
+    request.body = postData;
+
+    // Sending this twice fails with tabs that already exist
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::SHEETS, request, RequestScheduler::RETRY_UNPROCESSED);
+
+    if (!response.succeeded()) {
+        std::cerr << "Add sheet tabs request failed: " << response.describeFailure() << "\n";
+        return false;
+    }
+
+    // Replies come back in request order
+    tabs.clear();
+    nlohmann::json jsonResponse = nlohmann::json::parse(response.body);
+    for (const nlohmann::json& reply : jsonResponse["replies"]) {
+        tabs.push_back({ reply["addSheet"]["properties"]["sheetId"].get<int>(), reply["addSheet"]["properties"]["title"].get<std::string>() });
+    }
+
+    if (header.empty()) {
+        return true;
+    }
+
+    // The header needs the new ids, so it can only follow once the tabs exist
+    requests = nlohmann::json::array();
+    for (const SheetTab& tab : tabs) {
+        requests.push_back({
+            { "updateCells", {
+                { "start", {
+                    { "sheetId", tab.sheetId },
+                    { "rowIndex", 0 },
+                    { "columnIndex", 0 }
+                }},
+                { "rows", nlohmann::json::array({ toRowData(header) }) },
+                { "fields", "userEnteredValue" }
+            }}
+        });
+    }
+
+    batchUpdate["requests"] = requests;
+    postData = batchUpdate.dump();
+    request.body = postData;
+
+    // Rewriting the same header row is harmless, so this one may be retried
+    response = RequestScheduler::getInstance().perform(RequestScheduler::SHEETS, request);
+
+    if (!response.succeeded()) {
+        std::cerr << "Write sheet tab header request failed: " << response.describeFailure() << "\n";
+    }
+    return true;
+}
+
+bool GoogleSheetsAPI::insertRows(const std::string& accessToken, const std::string& spreadsheetId, int sheetId, std::vector<RowBlock> blocks) {
+    // Working from the bottom up keeps each index valid while the blocks above it are still to come
+    std::stable_sort(blocks.begin(), blocks.end(), [](const RowBlock& a, const RowBlock& b) {
+        return a.rowIndex > b.rowIndex;
+    });
+
+    nlohmann::json requests = nlohmann::json::array();
+    for (const RowBlock& block : blocks) {
+        const int rowCount = static_cast<int>(block.rows.size());
+        requests.push_back({
+            { "insertDimension", {
+                { "range", {
+                    { "sheetId", sheetId },
+                    { "dimension", "ROWS" },
+                    { "startIndex", block.rowIndex },
+                    { "endIndex", block.rowIndex + rowCount }
+                }},
+                { "inheritFromBefore", block.rowIndex > HEADER_ROWS }
+            }}
+        });
+
+        nlohmann::json rows = nlohmann::json::array();
+        for (const std::vector<std::string>& row : block.rows) {
+            rows.push_back(toRowData(row));
+        }
+
+        requests.push_back({
+            { "updateCells", {
+                { "start", {
+                    { "sheetId", sheetId },
+                    { "rowIndex", block.rowIndex },
+                    { "columnIndex", 0 }
+                }},
+                { "rows", rows },
+                { "fields", "userEnteredValue" }
+            }}
+        });
+    }
+
+    nlohmann::json batchUpdate;
+    batchUpdate["requests"] = requests;
+    std::string postData = batchUpdate.dump();
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postData.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WebUtils::writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
+    HttpRequest request;
+    request.method = "POST";
+    request.url = SHEETS_URL + spreadsheetId + ":batchUpdate";
+    request.headers.push_back("Authorization: Bearer " + accessToken);
+    request.headers.push_back("Content-Type: application/json");
+    request.body = postData;
 
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    // Inserting again after the server already did would duplicate the rows
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::SHEETS, request, RequestScheduler::RETRY_UNPROCESSED);
 
-    if (res != CURLE_OK) {
-        std::cerr << "Sort request failed: " << curl_easy_strerror(res) << "\n";
+    if (!response.succeeded()) {
+        std::cerr << "Insert rows request failed: " << response.describeFailure() << "\n";
+        return false;
     }
+    return true;
 }
\ No newline at end of file
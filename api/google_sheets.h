@@ -6,8 +6,35 @@
 
 namespace GoogleSheetsAPI {
 
-    void appendRowsToSheet(const std::string& accessToken, const std::string& spreadsheetId, const std::vector<std::vector<std::string>>& rowData);
+    // Every sheet starts with one header row; the UTC datetime column is its sort key
+    const int HEADER_ROWS = 1;
+    const int UTC_DATETIME_COLUMN_INDEX = 9;
+
+    // Rows to insert together, the first landing at rowIndex
+    struct RowBlock {
+        int rowIndex;
+        std::vector<std::vector<std::string>> rows;
+    };
+
+    // One tab of a spreadsheet
+    struct SheetTab {
+        int sheetId;
+        std::string title;
+    };
+
+    void appendRowsToSheet(const std::string& accessToken, const std::string& spreadsheetId, const std::string& sheetName, const std::vector<std::vector<std::string>>& rowData);
     void sortSheetByDateTime(const std::string& accessToken, const std::string& spreadsheetId, int sheetId = 0);
+    // Reads one column below the header rows, top to bottom
+    bool getColumnValues(const std::string& accessToken, const std::string& spreadsheetId, const std::string& sheetName, int columnIndex, std::vector<std::string>& values);
+    // Reads one row, left to right; rows are numbered from 1
+    bool getRowValues(const std::string& accessToken, const std::string& spreadsheetId, const std::string& sheetName, int rowNumber, std::vector<std::string>& values);
+    // Lists the tabs in the order they appear
+    bool getSheetTabs(const std::string& accessToken, const std::string& spreadsheetId, std::vector<SheetTab>& tabs);
+    // Adds the tabs in one batchUpdate and fills tabs with the ids Sheets assigned, then writes the frozen
+    // header row to them. A failed header write is only reported, since the tabs exist by then.
+    bool addSheetTabs(const std::string& accessToken, const std::string& spreadsheetId, const std::vector<std::string>& titles, const std::vector<std::string>& header, std::vector<SheetTab>& tabs);
+    // Inserts every block in one batchUpdate; row indexes refer to the sheet before any insertion
+    bool insertRows(const std::string& accessToken, const std::string& spreadsheetId, int sheetId, std::vector<RowBlock> blocks);
 
 }
 
@@ -0,0 +1,343 @@
+#include "http_client.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include "../utils/web_utils.h"
+
+// Larger Content-Length values are not trusted enough to allocate up front
+const size_t MAX_PRESIZE_BYTES = 64 * 1024 * 1024;
+const std::string BEARER_PREFIX = "Authorization: Bearer ";
+
+static double toMilliseconds(curl_off_t microseconds) {
+    return static_cast<double>(microseconds) / 1000.0;
+}
+
+static std::string trim(const std::string& text) {
+    const size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return "";
+    }
+    const size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(start, end - start + 1);
+}
+
+// Records each response header and reserves the body once its length is known
+static size_t headerCallback(char* buffer, size_t size, size_t nitems, HttpResponse* response) {
+    const size_t totalSize = size * nitems;
+    const std::string line(buffer, totalSize);
+
+    // A new status line starts the headers of a redirect or final response
+    if (line.rfind("HTTP/", 0) == 0) {
+        response->headers.clear();
+        return totalSize;
+    }
+
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+        return totalSize;
+    }
+
+    std::string name = line.substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    const std::string value = trim(line.substr(colon + 1));
+    response->headers[name] = value;
+
+    if (name == "content-length") {
+        try {
+            const unsigned long long length = std::stoull(value);
+            if (length <= MAX_PRESIZE_BYTES) {
+                response->body.reserve(static_cast<size_t>(length));
+            }
+        } catch (const std::exception&) {
+            // A malformed length only costs the presizing
+        }
+    }
+
+    return totalSize;
+}
+
+std::string HttpRequest::getBearerToken() const {
+    for (const std::string& header : headers) {
+        if (header.compare(0, BEARER_PREFIX.size(), BEARER_PREFIX) == 0) {
+            return header.substr(BEARER_PREFIX.size());
+        }
+    }
+    return "";
+}
+
+void HttpRequest::setBearerToken(const std::string& token) {
+    for (std::string& header : headers) {
+        if (header.compare(0, BEARER_PREFIX.size(), BEARER_PREFIX) == 0) {
+            header = BEARER_PREFIX + token;
+            return;
+        }
+    }
+    headers.push_back(BEARER_PREFIX + token);
+}
+
+bool HttpResponse::succeeded() const {
+    return error.empty() && status >= 200 && status < 300;
+}
+
+std::string HttpResponse::describeFailure() const {
+    if (!error.empty()) {
+        return error;
+    }
+    return "HTTP " + std::to_string(status) + (body.empty() ? "" : ": " + body);
+}
+
+FileBody::FileBody() : file(nullptr), offset(0), size(0), remaining(0) {}
+
+FileBody::~FileBody() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+bool FileBody::open(const std::string& path, curl_off_t offset, curl_off_t length) {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    std::error_code error;
+    const curl_off_t fileSize = static_cast<curl_off_t>(std::filesystem::file_size(path, error));
+    if (error || offset < 0 || offset > fileSize) {
+        return false;
+    }
+
+    file = std::fopen(path.c_str(), "rb");
+    if (!file || std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0) {
+        return false;
+    }
+
+    this->offset = offset;
+    size = (length < 0) ? fileSize - offset : std::min(length, fileSize - offset);
+    remaining = size;
+    return true;
+}
+
+curl_off_t FileBody::getSize() const {
+    return size;
+}
+
+size_t FileBody::read(char* buffer, size_t size, size_t nitems, void* fileBody) {
+    FileBody* body = static_cast<FileBody*>(fileBody);
+    const size_t wanted = std::min(size * nitems, static_cast<size_t>(body->remaining));
+    const size_t bytesRead = std::fread(buffer, 1, wanted, body->file);
+    if (bytesRead == 0 && wanted > 0 && std::ferror(body->file)) {
+        return CURL_READFUNC_ABORT;
+    }
+    body->remaining -= bytesRead;
+    return bytesRead;
+}
+
+// Lets libcurl rewind the body when a request has to be sent again.
+// libcurl only seeks from the start, which here is the start of the range.
+int FileBody::seek(void* fileBody, curl_off_t offset, int origin) {
+    FileBody* body = static_cast<FileBody*>(fileBody);
+    if (origin != SEEK_SET || offset < 0 || offset > body->size) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    if (std::fseek(body->file, static_cast<long>(body->offset + offset), SEEK_SET) != 0) {
+        return CURL_SEEKFUNC_FAIL;
+    }
+    body->remaining = body->size - offset;
+    return CURL_SEEKFUNC_OK;
+}
+
+bool HttpTransfer::buildHeaderList(const std::vector<std::string>& headers, HeaderList& headerList) {
+    for (const std::string& header : headers) {
+        curl_slist* appended = curl_slist_append(headerList.get(), header.c_str());
+        if (!appended) {
+            return false;
+        }
+        headerList.release();
+        headerList.reset(appended);
+    }
+    return true;
+}
+
+void HttpTransfer::setOptions(CURL* handle, const HttpRequest& request, curl_slist* headerList, HttpResponse& response, FileBody* fileBody) {
+    curl_easy_setopt(handle, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headerList);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WebUtils::writeCallback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response.body);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, &response);
+
+    if (request.method == "GET") {
+        curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
+        return;
+    }
+
+    if (request.method != "POST") {
+        curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+    }
+
+    if (fileBody) {
+        // A known size sends a Content-Length rather than a chunked body
+        curl_easy_setopt(handle, CURLOPT_POST, 1L);
+        curl_easy_setopt(handle, CURLOPT_READFUNCTION, FileBody::read);
+        curl_easy_setopt(handle, CURLOPT_READDATA, fileBody);
+        curl_easy_setopt(handle, CURLOPT_SEEKFUNCTION, FileBody::seek);
+        curl_easy_setopt(handle, CURLOPT_SEEKDATA, fileBody);
+        curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE_LARGE, fileBody->getSize());
+    } else {
+        // A null pointer would make libcurl read the body from a callback instead
+        curl_easy_setopt(handle, CURLOPT_POSTFIELDS, request.body.empty() ? "" : request.body.data());
+        curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(request.body.size()));
+    }
+}
+
+void HttpTransfer::readResult(CURL* handle, CURLcode result, HttpResponse& response) {
+    if (result != CURLE_OK) {
+        response.error = curl_easy_strerror(result);
+    }
+
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.status);
+
+    curl_off_t nameLookup = 0, connect = 0, appConnect = 0, preTransfer = 0, startTransfer = 0, total = 0;
+    long connects = 0;
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &nameLookup);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+    curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &preTransfer);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &startTransfer);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+
+    // libcurl reports each phase as time since the start of the request
+    response.timings.dnsMs = toMilliseconds(nameLookup);
+    response.timings.connectMs = connect > 0 ? toMilliseconds(connect - nameLookup) : 0.0;
+    response.timings.tlsMs = appConnect > 0 ? toMilliseconds(appConnect - connect) : 0.0;
+    response.timings.ttfbMs = startTransfer > 0 ? toMilliseconds(startTransfer - preTransfer) : 0.0;
+    response.timings.totalMs = toMilliseconds(total);
+    response.timings.reusedConnection = result == CURLE_OK && connects == 0;
+}
+
+HttpClient& HttpClient::getInstance() {
+    static HttpClient instance;
+    return instance;
+}
+
+HttpClient::HttpClient() : requests(0), reusedConnections(0), totalConnectMs(0.0), totalTlsMs(0.0), totalTtfbMs(0.0) {
+    share = curl_share_init();
+    if (share) {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    } else {
+        std::cerr << "Failed to initialize cURL share, requests will not share DNS or TLS sessions." << std::endl;
+    }
+}
+
+HttpClient::~HttpClient() {
+    for (CURL* handle : idleHandles) {
+        curl_easy_cleanup(handle);
+    }
+    if (share) {
+        curl_share_cleanup(share);
+    }
+}
+
+HttpResponse HttpClient::perform(const HttpRequest& request) {
+    HttpResponse response;
+
+    CURL* curl = acquireHandle();
+    if (!curl) {
+        response.error = "CURL initialization failed";
+        return response;
+    }
+
+    HttpTransfer::HeaderList headerList(nullptr, curl_slist_free_all);
+    if (!HttpTransfer::buildHeaderList(request.headers, headerList)) {
+        releaseHandle(curl);
+        response.error = "Failed to build request headers";
+        return response;
+    }
+
+    FileBody fileBody;
+    if (!request.bodyFile.empty() && !fileBody.open(request.bodyFile, request.bodyFileOffset, request.bodyFileLength)) {
+        releaseHandle(curl);
+        response.error = "Failed to open " + request.bodyFile;
+        return response;
+    }
+
+    HttpTransfer::setOptions(curl, request, headerList.get(), response, request.bodyFile.empty() ? nullptr : &fileBody);
+    const CURLcode res = curl_easy_perform(curl);
+    HttpTransfer::readResult(curl, res, response);
+
+    releaseHandle(curl);
+    recordTimings(response.timings);
+
+    return response;
+}
+
+CURLSH* HttpClient::getShare() const {
+    return share;
+}
+
+void HttpClient::printStats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (requests == 0) {
+        return;
+    }
+
+    std::cout << "HTTP client: " << requests << " requests, " << reusedConnections << " on reused connections, "
+              << "average connect " << totalConnectMs / requests << " ms, "
+              << "TLS " << totalTlsMs / requests << " ms, "
+              << "time to first byte " << totalTtfbMs / requests << " ms" << std::endl;
+}
+
+CURL* HttpClient::acquireHandle() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!idleHandles.empty()) {
+            CURL* handle = idleHandles.back();
+            idleHandles.pop_back();
+            return handle;
+        }
+    }
+
+    CURL* handle = curl_easy_init();
+    if (handle && share) {
+        // curl_easy_reset keeps the share, so this only has to be set once per handle
+        curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    }
+    return handle;
+}
+
+// Resetting clears the options but keeps the handle's open connections for the next request
+void HttpClient::releaseHandle(CURL* handle) {
+    curl_easy_reset(handle);
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    idleHandles.push_back(handle);
+}
+
+void HttpClient::recordTimings(const HttpTimings& timings) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    requests++;
+    if (timings.reusedConnection) {
+        reusedConnections++;
+    }
+    totalConnectMs += timings.connectMs;
+    totalTlsMs += timings.tlsMs;
+    totalTtfbMs += timings.ttfbMs;
+}
+
+void HttpClient::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* client) {
+    static_cast<HttpClient*>(client)->shareMutexes[data].lock();
+}
+
+void HttpClient::unlockShare(CURL*, curl_lock_data data, void* client) {
+    static_cast<HttpClient*>(client)->shareMutexes[data].unlock();
+}
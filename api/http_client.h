@@ -0,0 +1,121 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <cstddef>
+#include <cstdio>
+#include <curl/curl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct HttpRequest {
+    std::string method = "GET";
+    std::string url;
+    std::vector<std::string> headers;
+    std::string_view body;
+    // When set, the body is streamed from this file and `body` is ignored.
+    // A negative length sends everything after the offset.
+    std::string bodyFile;
+    curl_off_t bodyFileOffset = 0;
+    curl_off_t bodyFileLength = -1;
+
+    // The token in the Authorization header, or an empty string when there is none
+    std::string getBearerToken() const;
+    void setBearerToken(const std::string& token);
+};
+
+// Phase durations of a single request, measured by libcurl
+struct HttpTimings {
+    double dnsMs = 0.0;
+    double connectMs = 0.0;
+    double tlsMs = 0.0;
+    double ttfbMs = 0.0;
+    double totalMs = 0.0;
+    bool reusedConnection = false;
+};
+
+struct HttpResponse {
+    long status = 0;
+    std::string body;
+    std::map<std::string, std::string> headers; // names are lowercase
+    std::string error; // set when the transfer itself failed
+    HttpTimings timings;
+
+    // The transfer completed with a 2xx status
+    bool succeeded() const;
+    std::string describeFailure() const;
+};
+
+// Feeds a request body to libcurl straight from disk, so only libcurl's upload buffer is ever in memory
+class FileBody {
+public:
+    FileBody();
+    ~FileBody();
+    bool open(const std::string& path, curl_off_t offset, curl_off_t length);
+    curl_off_t getSize() const;
+    static size_t read(char* buffer, size_t size, size_t nitems, void* fileBody);
+    static int seek(void* fileBody, curl_off_t offset, int origin);
+
+private:
+    FileBody(const FileBody&) = delete;
+    FileBody& operator=(const FileBody&) = delete;
+
+private:
+    std::FILE* file;
+    curl_off_t offset;
+    curl_off_t size;
+    curl_off_t remaining;
+
+};
+
+// Handle setup shared by the blocking client and the upload engine
+namespace HttpTransfer {
+
+    using HeaderList = std::unique_ptr<curl_slist, void (*)(curl_slist*)>;
+
+    bool buildHeaderList(const std::vector<std::string>& headers, HeaderList& headerList);
+    // fileBody must be open when the request streams its body from a file
+    void setOptions(CURL* handle, const HttpRequest& request, curl_slist* headerList, HttpResponse& response, FileBody* fileBody);
+    void readResult(CURL* handle, CURLcode result, HttpResponse& response);
+
+}
+
+// Performs requests on pooled easy handles, so each handle keeps its connections alive between calls.
+// DNS results and TLS sessions are shared between all handles through one share object.
+class HttpClient {
+public:
+    static HttpClient& getInstance();
+    HttpResponse perform(const HttpRequest& request);
+    CURLSH* getShare() const;
+    void printStats();
+
+private:
+    HttpClient();
+    ~HttpClient();
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    CURL* acquireHandle();
+    void releaseHandle(CURL* handle);
+    void recordTimings(const HttpTimings& timings);
+    static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* client);
+    static void unlockShare(CURL* handle, curl_lock_data data, void* client);
+
+private:
+    CURLSH* share;
+    std::mutex shareMutexes[CURL_LOCK_DATA_LAST];
+    std::vector<CURL*> idleHandles;
+    std::mutex poolMutex;
+    std::mutex statsMutex;
+    unsigned long requests;
+    unsigned long reusedConnections;
+    double totalConnectMs;
+    double totalTlsMs;
+    double totalTtfbMs;
+
+};
+
+#endif // HTTP_CLIENT_H
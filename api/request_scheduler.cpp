@@ -0,0 +1,187 @@
+#include "request_scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include "google_auth.h"
+#include "../config/config_handler.h"
+
+namespace ConfigConst = ConfigConstants;
+
+// Matches the order of RequestScheduler::Api; each is also the API's key under rate_limits
+const std::string API_NAMES[RequestScheduler::API_COUNT] = {"docs", "drive", "photos", "sheets", "oauth"};
+// A request waiting only for a concurrency slot has no better time to check again
+const std::chrono::milliseconds CONCURRENCY_RECHECK(50);
+
+RequestScheduler& RequestScheduler::getInstance() {
+    static RequestScheduler instance;
+    return instance;
+}
+
+RequestScheduler::RequestScheduler() : random(std::random_device{}()) {
+    ConfigHandler& config = ConfigHandler::getInstance();
+    maxRetries = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::RATE_LIMITS, ConfigConst::MAX_RETRIES);
+    baseBackoffMs = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::RATE_LIMITS, ConfigConst::BASE_BACKOFF_MS);
+    maxBackoffMs = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::RATE_LIMITS, ConfigConst::MAX_BACKOFF_MS);
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (int i = 0; i < API_COUNT; i++) {
+        ApiState& state = apis[i];
+        state.name = API_NAMES[i];
+        state.tokensPerSecond = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::RATE_LIMITS, state.name, ConfigConst::REQUESTS_PER_SECOND).get<double>();
+        state.burst = std::max(1.0, config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::RATE_LIMITS, state.name, ConfigConst::BURST).get<double>());
+        state.tokens = state.burst;
+        state.lastRefill = now;
+        state.pausedUntil = now;
+        state.maxConcurrency = std::max(1.0, config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::RATE_LIMITS, state.name, ConfigConst::MAX_CONCURRENCY).get<double>());
+        state.concurrencyLimit = state.maxConcurrency;
+        state.inFlight = 0;
+        state.requests = 0;
+        state.retries = 0;
+        state.throttled = 0;
+    }
+}
+
+HttpResponse RequestScheduler::perform(Api api, const HttpRequest& request, RetryPolicy retryPolicy) {
+    const HttpRequest* current = &request;
+    HttpRequest reauthorized;
+
+    for (int attempt = 0; ; attempt++) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            std::chrono::milliseconds wait(0);
+            while (!tryStartLocked(apis[api], wait)) {
+                capacityFreed.wait_for(lock, wait);
+            }
+        }
+
+        HttpResponse response = HttpClient::getInstance().perform(*current);
+
+        std::chrono::milliseconds retryDelay(0);
+        if (!finish(api, response, attempt, retryPolicy, retryDelay)) {
+            // A rejected token is replaced once; the refresh is shared with any other request it rejected
+            const std::string rejectedToken = request.getBearerToken();
+            if (response.status == 401 && current == &request && !rejectedToken.empty()) {
+                const std::string newToken = GoogleAuth::getInstance().refreshAccessToken(rejectedToken).get();
+                if (!newToken.empty()) {
+                    reauthorized = request;
+                    reauthorized.setBearerToken(newToken);
+                    current = &reauthorized;
+                    continue;
+                }
+            }
+            return response;
+        }
+        std::this_thread::sleep_for(retryDelay);
+    }
+}
+
+bool RequestScheduler::tryStart(Api api, std::chrono::milliseconds& wait) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tryStartLocked(apis[api], wait);
+}
+
+// Records the outcome and frees the request's slot. Returns true with a delay if it should be sent again.
+bool RequestScheduler::finish(Api api, const HttpResponse& response, int attempt, RetryPolicy retryPolicy, std::chrono::milliseconds& retryDelay) {
+    const bool throttled = response.status == 429 || response.status == 503;
+    // A transport error or other 5xx may come after the server already applied the request
+    const bool failed = !response.error.empty() || response.status >= 500;
+    const bool retryable = (retryPolicy == RETRY_FAILURES && (throttled || failed)) || (retryPolicy == RETRY_UNPROCESSED && throttled);
+
+    bool retry = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ApiState& state = apis[api];
+        state.inFlight--;
+
+        // Additive increase, multiplicative decrease
+        if (throttled) {
+            state.throttled++;
+            state.concurrencyLimit = std::max(1.0, state.concurrencyLimit / 2.0);
+        } else if (response.succeeded()) {
+            state.concurrencyLimit = std::min(state.maxConcurrency, state.concurrencyLimit + 1.0 / state.concurrencyLimit);
+        }
+
+        if (retryable && attempt < maxRetries) {
+            retry = true;
+            state.retries++;
+            retryDelay = getRetryDelay(response, attempt);
+        }
+
+        // Retry-After applies to every request to that API, not just this one
+        if (response.headers.count("retry-after")) {
+            state.pausedUntil = std::max(state.pausedUntil, std::chrono::steady_clock::now() + getRetryDelay(response, attempt));
+        }
+    }
+
+    capacityFreed.notify_all();
+    return retry;
+}
+
+void RequestScheduler::abandon(Api api) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        apis[api].inFlight--;
+    }
+    capacityFreed.notify_all();
+}
+
+void RequestScheduler::printStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const ApiState& state : apis) {
+        if (state.requests == 0) {
+            continue;
+        }
+
+        std::cout << "Rate limiter (" << state.name << "): " << state.requests << " requests, " << state.retries << " retries, "
+                  << state.throttled << " throttled, concurrency limit " << static_cast<int>(state.concurrencyLimit) << std::endl;
+    }
+}
+
+// A rate of 0 turns the token bucket off for that API
+bool RequestScheduler::tryStartLocked(ApiState& state, std::chrono::milliseconds& wait) {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now < state.pausedUntil) {
+        wait = std::chrono::ceil<std::chrono::milliseconds>(state.pausedUntil - now);
+        return false;
+    }
+
+    if (state.inFlight >= static_cast<int>(state.concurrencyLimit)) {
+        wait = CONCURRENCY_RECHECK;
+        return false;
+    }
+
+    if (state.tokensPerSecond > 0.0) {
+        const double elapsedSeconds = std::chrono::duration<double>(now - state.lastRefill).count();
+        state.tokens = std::min(state.burst, state.tokens + elapsedSeconds * state.tokensPerSecond);
+        state.lastRefill = now;
+
+        if (state.tokens < 1.0) {
+            wait = std::chrono::milliseconds(static_cast<long>(std::ceil((1.0 - state.tokens) / state.tokensPerSecond * 1000.0)));
+            return false;
+        }
+        state.tokens -= 1.0;
+    }
+
+    state.inFlight++;
+    state.requests++;
+    return true;
+}
+
+// Uses the server's Retry-After seconds when given, capped at the longest backoff, otherwise an exponential
+// backoff where the second half of each step is random so clients that failed together do not retry together
+std::chrono::milliseconds RequestScheduler::getRetryDelay(const HttpResponse& response, int attempt) {
+    auto retryAfter = response.headers.find("retry-after");
+    if (retryAfter != response.headers.end()) {
+        try {
+            const std::chrono::milliseconds serverDelay = std::chrono::seconds(std::stol(retryAfter->second));
+            return std::min(serverDelay, std::chrono::milliseconds(maxBackoffMs));
+        } catch (const std::exception&) {
+            // An HTTP date falls back to the backoff
+        }
+    }
+
+    const double step = std::min(static_cast<double>(maxBackoffMs), baseBackoffMs * std::pow(2.0, attempt));
+    std::uniform_real_distribution<double> jitter(0.0, step / 2.0);
+    return std::chrono::milliseconds(static_cast<long>(step / 2.0 + jitter(random)));
+}
@@ -0,0 +1,81 @@
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include "http_client.h"
+
+// Paces requests to each Google API with a token bucket and an adaptive concurrency limit.
+// Throttled and failed requests are retried after the server's Retry-After or an exponential
+// backoff with jitter, and throttling halves that API's concurrency while successes slowly raise it.
+// A request whose access token is rejected is sent once more with a refreshed one.
+class RequestScheduler {
+public:
+    enum Api {
+        DOCS,
+        DRIVE,
+        PHOTOS,
+        SHEETS,
+        OAUTH,
+        API_COUNT
+    };
+
+    // Which failures a request may be sent again after
+    enum RetryPolicy {
+        // Transport errors, 429 and 5xx; for requests that are safe to repeat
+        RETRY_FAILURES,
+        // Only 429 and 503, where the server did not act on the request; for ones that are not safe to repeat
+        RETRY_UNPROCESSED,
+        // Never; for callers that recover on their own
+        RETRY_NONE
+    };
+
+    static RequestScheduler& getInstance();
+    // Blocks until the API has capacity and retries until the response is final
+    HttpResponse perform(Api api, const HttpRequest& request, RetryPolicy retryPolicy = RETRY_FAILURES);
+
+    // Non-blocking steps for callers with their own event loop. tryStart takes a slot or says how long
+    // to wait; every started request must be passed to finish, or to abandon if it was never sent.
+    bool tryStart(Api api, std::chrono::milliseconds& wait);
+    bool finish(Api api, const HttpResponse& response, int attempt, RetryPolicy retryPolicy, std::chrono::milliseconds& retryDelay);
+    void abandon(Api api);
+    void printStats();
+
+private:
+    struct ApiState {
+        std::string name;
+        double tokensPerSecond;
+        double burst;
+        double tokens;
+        std::chrono::steady_clock::time_point lastRefill;
+        std::chrono::steady_clock::time_point pausedUntil;
+        double maxConcurrency;
+        double concurrencyLimit;
+        int inFlight;
+        unsigned long requests;
+        unsigned long retries;
+        unsigned long throttled;
+    };
+
+    RequestScheduler();
+    RequestScheduler(const RequestScheduler&) = delete;
+    RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+    bool tryStartLocked(ApiState& state, std::chrono::milliseconds& wait);
+    std::chrono::milliseconds getRetryDelay(const HttpResponse& response, int attempt);
+
+private:
+    ApiState apis[API_COUNT];
+    int maxRetries;
+    long baseBackoffMs;
+    long maxBackoffMs;
+    std::mt19937 random;
+    std::mutex mutex;
+    std::condition_variable capacityFreed;
+
+};
+
+#endif // REQUEST_SCHEDULER_H
@@ -0,0 +1,135 @@
+#include "resumable_upload.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "request_scheduler.h"
+
+const std::string IMAGE_MIME_TYPE = "image/png";
+const std::string HEADER_SESSION_URL = "x-goog-upload-url";
+const std::string HEADER_CHUNK_GRANULARITY = "x-goog-upload-chunk-granularity";
+const std::string HEADER_STATUS = "x-goog-upload-status";
+const std::string HEADER_SIZE_RECEIVED = "x-goog-upload-size-received";
+const std::string STATUS_FINAL = "final";
+const int RETRY_DELAY_MS = 500;
+
+static HttpRequest buildRequest(const std::string& accessToken, const std::string& url, const std::string& command) {
+    HttpRequest request;
+    request.method = "POST";
+    request.url = url;
+    request.headers.push_back("Authorization: Bearer " + accessToken);
+    request.headers.push_back("X-Goog-Upload-Protocol: resumable");
+    request.headers.push_back("X-Goog-Upload-Command: " + command);
+    return request;
+}
+
+static uint64_t parseHeader(const HttpResponse& response, const std::string& name, uint64_t fallback) {
+    auto header = response.headers.find(name);
+    if (header == response.headers.end()) {
+        return fallback;
+    }
+
+    try {
+        return std::stoull(header->second);
+    } catch (const std::exception&) {
+        return fallback;
+    }
+}
+
+// Returns the session URL that the chunks are sent to
+static std::string startSession(const std::string& accessToken, const std::string& uploadUrl, uint64_t size, uint64_t& granularity) {
+    HttpRequest request = buildRequest(accessToken, uploadUrl, "start");
+    request.headers.push_back("X-Goog-Upload-Content-Type: " + IMAGE_MIME_TYPE);
+    request.headers.push_back("X-Goog-Upload-Raw-Size: " + std::to_string(size));
+
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::PHOTOS, request);
+    auto sessionUrl = response.headers.find(HEADER_SESSION_URL);
+    if (!response.succeeded() || sessionUrl == response.headers.end()) {
+        std::cerr << "Failed to start resumable upload: " << response.describeFailure() << std::endl;
+        return "";
+    }
+
+    granularity = parseHeader(response, HEADER_CHUNK_GRANULARITY, 1);
+    return sessionUrl->second;
+}
+
+// Asks how much of the upload the server has. The upload token is filled in instead
+// if the last chunk arrived and only its response was lost.
+static bool queryOffset(const std::string& accessToken, const std::string& sessionUrl, uint64_t& offset, std::string& uploadToken) {
+    HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::PHOTOS, buildRequest(accessToken, sessionUrl, "query"), RequestScheduler::RETRY_NONE);
+    if (!response.succeeded()) {
+        std::cerr << "Failed to query resumable upload: " << response.describeFailure() << std::endl;
+        return false;
+    }
+
+    auto status = response.headers.find(HEADER_STATUS);
+    if (status != response.headers.end() && status->second == STATUS_FINAL) {
+        uploadToken = response.body;
+        return true;
+    }
+
+    const uint64_t received = parseHeader(response, HEADER_SIZE_RECEIVED, UINT64_MAX);
+    if (received == UINT64_MAX) {
+        return false;
+    }
+    offset = received;
+    return true;
+}
+
+std::string ResumableUpload::upload(const TokenProvider& getAccessToken, const std::string& uploadUrl, const Source& source, uint64_t chunkSize, int maxAttempts) {
+    uint64_t granularity = 1;
+    const std::string sessionUrl = startSession(getAccessToken(), uploadUrl, source.size, granularity);
+    if (sessionUrl.empty()) {
+        return "";
+    }
+
+    // Every chunk but the last has to be a multiple of the server's granularity
+    granularity = std::max<uint64_t>(1, granularity);
+    chunkSize = std::max(granularity, chunkSize / granularity * granularity);
+
+    uint64_t offset = 0;
+    int failures = 0;
+    while (true) {
+        const uint64_t length = std::min(chunkSize, source.size - offset);
+        const bool last = offset + length == source.size;
+
+        HttpRequest request = buildRequest(getAccessToken(), sessionUrl, last ? "upload, finalize" : "upload");
+        request.headers.push_back("X-Goog-Upload-Offset: " + std::to_string(offset));
+        if (source.filePath.empty()) {
+            request.body = source.data.substr(offset, length);
+        } else {
+            request.bodyFile = source.filePath;
+            request.bodyFileOffset = static_cast<curl_off_t>(offset);
+            request.bodyFileLength = static_cast<curl_off_t>(length);
+        }
+
+        // A failed chunk goes straight to the offset query rather than being resent whole
+        HttpResponse response = RequestScheduler::getInstance().perform(RequestScheduler::PHOTOS, request, RequestScheduler::RETRY_NONE);
+        if (response.succeeded()) {
+            if (last) {
+                return response.body;
+            }
+            offset += length;
+            failures = 0;
+            continue;
+        }
+
+        failures++;
+        std::cerr << "Resumable upload chunk at byte " << offset << " failed: " << response.describeFailure() << std::endl;
+        if (failures >= maxAttempts) {
+            std::cerr << "Giving up on resumable upload after " << failures << " failed attempts." << std::endl;
+            return "";
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(RETRY_DELAY_MS * failures));
+
+        // Without an answer the same chunk is simply sent again
+        std::string uploadToken;
+        uint64_t received = offset;
+        if (queryOffset(getAccessToken(), sessionUrl, received, uploadToken)) {
+            if (!uploadToken.empty()) {
+                return uploadToken;
+            }
+            offset = std::min(received, source.size);
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef RESUMABLE_UPLOAD_H
+#define RESUMABLE_UPLOAD_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Client side of Google's resumable upload protocol. The image is sent in chunks, and after a failed
+// chunk the server is asked how many bytes it has so the upload carries on from there.
+namespace ResumableUpload {
+
+    // Either an in-memory image or a file, which is streamed one chunk at a time
+    struct Source {
+        std::string_view data;
+        std::string filePath;
+        uint64_t size;
+    };
+
+    // Called before every request, so an upload that outlives an access token picks up the refreshed one
+    using TokenProvider = std::function<std::string()>;
+
+    // Returns the upload token, or an empty string once maxAttempts requests in a row have failed
+    std::string upload(const TokenProvider& getAccessToken, const std::string& uploadUrl, const Source& source, uint64_t chunkSize, int maxAttempts);
+
+}
+
+#endif // RESUMABLE_UPLOAD_H
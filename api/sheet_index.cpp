@@ -0,0 +1,42 @@
+#include "sheet_index.h"
+#include <algorithm>
+#include <functional>
+
+static const std::string& getKey(const std::vector<std::string>& row, size_t keyColumn) {
+    static const std::string NO_KEY;
+    return keyColumn < row.size() ? row.at(keyColumn) : NO_KEY;
+}
+
+SheetIndex::SheetIndex() {}
+
+SheetIndex::SheetIndex(std::vector<std::string> keys) : keys(std::move(keys)) {}
+
+std::vector<GoogleSheetsAPI::RowBlock> SheetIndex::place(std::vector<std::vector<std::string>> rows, size_t keyColumn) {
+    std::stable_sort(rows.begin(), rows.end(), [keyColumn](const std::vector<std::string>& a, const std::vector<std::string>& b) {
+        return getKey(a, keyColumn) > getKey(b, keyColumn);
+    });
+
+    std::vector<GoogleSheetsAPI::RowBlock> blocks;
+    std::vector<std::string> merged;
+    merged.reserve(keys.size() + rows.size());
+
+    // Positions only grow since the rows are sorted the same way as the keys
+    auto next = keys.begin();
+    for (std::vector<std::string>& row : rows) {
+        const std::string& key = getKey(row, keyColumn);
+        auto position = std::upper_bound(next, keys.end(), key, std::greater<std::string>());
+        merged.insert(merged.end(), next, position);
+        merged.push_back(key);
+        next = position;
+
+        const int rowIndex = GoogleSheetsAPI::HEADER_ROWS + static_cast<int>(position - keys.begin());
+        if (blocks.empty() || blocks.back().rowIndex != rowIndex) {
+            blocks.push_back({rowIndex, {}});
+        }
+        blocks.back().rows.push_back(std::move(row));
+    }
+    merged.insert(merged.end(), next, keys.end());
+
+    keys = std::move(merged);
+    return blocks;
+}
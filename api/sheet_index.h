@@ -0,0 +1,24 @@
+#ifndef SHEET_INDEX_H
+#define SHEET_INDEX_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "google_sheets.h"
+
+// Local copy of a sheet's sort keys, which are kept in descending order below the header rows.
+// Works out where new rows belong so they can be inserted in place instead of re-sorting the sheet.
+class SheetIndex {
+public:
+    SheetIndex();
+    explicit SheetIndex(std::vector<std::string> keys);
+    // Groups the rows into blocks that share an insertion point and adds their keys to the index.
+    // Rows with a key equal to an existing one go below it.
+    std::vector<GoogleSheetsAPI::RowBlock> place(std::vector<std::vector<std::string>> rows, size_t keyColumn);
+
+private:
+    std::vector<std::string> keys;
+
+};
+
+#endif // SHEET_INDEX_H
@@ -0,0 +1,278 @@
+#include "upload_engine.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include "google_auth.h"
+#include "../config/config_handler.h"
+
+namespace ConfigConst = ConfigConstants;
+
+// Upper bound on how long the event loop sleeps when nothing wakes it
+const int POLL_TIMEOUT_MS = 1000;
+// How often a transfer waiting on a token refresh checks whether it has arrived
+const std::chrono::milliseconds TOKEN_RECHECK(20);
+
+UploadEngine& UploadEngine::getInstance() {
+    static UploadEngine instance;
+    return instance;
+}
+
+UploadEngine::UploadEngine() : stopping(false), inFlight(0), peakInFlight(0), completed(0), retried(0), reusedConnections(0) {
+    maxInFlight = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::UPLOADS, ConfigConst::MAX_IN_FLIGHT);
+    maxInFlight = std::max<size_t>(1, maxInFlight);
+
+    // Constructed first so the shared DNS and TLS session caches and the scheduler outlive the engine
+    HttpClient::getInstance();
+    RequestScheduler::getInstance();
+
+    multi = curl_multi_init();
+    if (!multi) {
+        throw std::runtime_error("Failed to initialize cURL multi handle.");
+    }
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(maxInFlight));
+
+    worker = std::thread(&UploadEngine::eventLoop, this);
+}
+
+// Finishes every submitted transfer before returning
+UploadEngine::~UploadEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    curl_multi_wakeup(multi);
+    worker.join();
+
+    for (CURL* handle : idleHandles) {
+        curl_easy_cleanup(handle);
+    }
+    curl_multi_cleanup(multi);
+}
+
+void UploadEngine::submit(RequestScheduler::Api api, const HttpRequest& request, Callback onComplete) {
+    std::unique_ptr<Transfer> transfer = std::make_unique<Transfer>();
+    transfer->request = request;
+    transfer->onComplete = std::move(onComplete);
+    transfer->api = api;
+    transfer->notBefore = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(transfer));
+    }
+    curl_multi_wakeup(multi);
+}
+
+std::future<HttpResponse> UploadEngine::submit(RequestScheduler::Api api, const HttpRequest& request) {
+    std::shared_ptr<std::promise<HttpResponse>> promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> future = promise->get_future();
+
+    submit(api, request, [promise](HttpResponse& response) {
+        promise->set_value(std::move(response));
+    });
+
+    return future;
+}
+
+void UploadEngine::printStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (completed == 0) {
+        return;
+    }
+
+    std::cout << "Upload engine: " << completed << " transfers, " << retried << " retries, " << reusedConnections << " on existing connections, "
+              << "peak " << peakInFlight << " in flight (limit " << maxInFlight << ")" << std::endl;
+}
+
+void UploadEngine::eventLoop() {
+    long timeoutMs = POLL_TIMEOUT_MS;
+    while (startTransfers(timeoutMs)) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        finishTransfers();
+
+        // Returns early when a transfer has data or submit() calls curl_multi_wakeup
+        curl_multi_poll(multi, nullptr, 0, static_cast<int>(timeoutMs), nullptr);
+    }
+}
+
+// Moves pending transfers that the scheduler lets through onto the multi handle, up to the in-flight
+// limit, and sets the timeout to when the next waiting one may be ready.
+// Returns false once the engine is stopping and has nothing left to do.
+bool UploadEngine::startTransfers(long& timeoutMs) {
+    std::vector<std::unique_ptr<Transfer>> starting;
+    timeoutMs = POLL_TIMEOUT_MS;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping && pending.empty() && inFlight == 0) {
+            return false;
+        }
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        auto next = pending.begin();
+        while (next != pending.end() && inFlight < maxInFlight) {
+            std::chrono::milliseconds wait(0);
+            if ((*next)->notBefore > now) {
+                wait = std::chrono::ceil<std::chrono::milliseconds>((*next)->notBefore - now);
+            } else if ((*next)->newToken.valid() && (*next)->newToken.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                wait = TOKEN_RECHECK;
+            } else if (RequestScheduler::getInstance().tryStart((*next)->api, wait)) {
+                starting.push_back(std::move(*next));
+                next = pending.erase(next);
+                inFlight++;
+                continue;
+            }
+
+            timeoutMs = std::min<long>(timeoutMs, std::max<long>(1, wait.count()));
+            ++next;
+        }
+        peakInFlight = std::max(peakInFlight, inFlight);
+    }
+
+    for (std::unique_ptr<Transfer>& transfer : starting) {
+        startTransfer(std::move(transfer));
+    }
+    return true;
+}
+
+void UploadEngine::startTransfer(std::unique_ptr<Transfer> transfer) {
+    CURL* handle = nullptr;
+    if (!idleHandles.empty()) {
+        handle = idleHandles.back();
+        idleHandles.pop_back();
+    } else {
+        handle = curl_easy_init();
+        if (handle && HttpClient::getInstance().getShare()) {
+            curl_easy_setopt(handle, CURLOPT_SHARE, HttpClient::getInstance().getShare());
+        }
+    }
+
+    if (!handle) {
+        fail(std::move(transfer), "CURL initialization failed");
+        return;
+    }
+
+    if (transfer->newToken.valid()) {
+        const std::string token = transfer->newToken.get();
+        transfer->newToken = std::shared_future<std::string>();
+        if (token.empty()) {
+            idleHandles.push_back(handle);
+            fail(std::move(transfer), "Access token was rejected and could not be refreshed");
+            return;
+        }
+        transfer->request.setBearerToken(token);
+    }
+
+    if (!HttpTransfer::buildHeaderList(transfer->request.headers, transfer->headerList)) {
+        idleHandles.push_back(handle);
+        fail(std::move(transfer), "Failed to build request headers");
+        return;
+    }
+
+    const HttpRequest& request = transfer->request;
+    if (!request.bodyFile.empty() && !transfer->fileBody.open(request.bodyFile, request.bodyFileOffset, request.bodyFileLength)) {
+        idleHandles.push_back(handle);
+        fail(std::move(transfer), "Failed to open " + request.bodyFile);
+        return;
+    }
+
+    const bool streamsFile = !transfer->request.bodyFile.empty();
+    HttpTransfer::setOptions(handle, transfer->request, transfer->headerList.get(), transfer->response, streamsFile ? &transfer->fileBody : nullptr);
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    // Waits for an existing connection to confirm HTTP/2 rather than opening another one
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(handle, CURLOPT_PRIVATE, transfer.get());
+
+    const CURLMcode res = curl_multi_add_handle(multi, handle);
+    if (res != CURLM_OK) {
+        curl_easy_reset(handle);
+        idleHandles.push_back(handle);
+        fail(std::move(transfer), curl_multi_strerror(res));
+        return;
+    }
+
+    // Owned by the multi handle until the transfer is done
+    transfer.release();
+}
+
+void UploadEngine::finishTransfers() {
+    int messagesLeft = 0;
+    CURLMsg* message = nullptr;
+    while ((message = curl_multi_info_read(multi, &messagesLeft))) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        // The message is freed by curl_multi_remove_handle, so read it first
+        CURL* handle = message->easy_handle;
+        const CURLcode result = message->data.result;
+
+        Transfer* finished = nullptr;
+        curl_easy_getinfo(handle, CURLINFO_PRIVATE, &finished);
+        std::unique_ptr<Transfer> transfer(finished);
+
+        curl_multi_remove_handle(multi, handle);
+        HttpTransfer::readResult(handle, result, transfer->response);
+        curl_easy_reset(handle);
+        idleHandles.push_back(handle);
+
+        std::chrono::milliseconds retryDelay(0);
+        if (RequestScheduler::getInstance().finish(transfer->api, transfer->response, transfer->attempt, RequestScheduler::RETRY_FAILURES, retryDelay)) {
+            retry(std::move(transfer), retryDelay);
+        } else if (!reauthorize(transfer)) {
+            complete(std::move(transfer));
+        }
+    }
+}
+
+// For transfers that could not be set up, which are not worth retrying
+void UploadEngine::fail(std::unique_ptr<Transfer> transfer, const std::string& error) {
+    RequestScheduler::getInstance().abandon(transfer->api);
+    transfer->response.error = error;
+    complete(std::move(transfer));
+}
+
+// Queues the transfer again, to start once the delay has passed
+void UploadEngine::retry(std::unique_ptr<Transfer> transfer, std::chrono::milliseconds delay) {
+    transfer->response = HttpResponse();
+    transfer->headerList.reset();
+    transfer->attempt++;
+    transfer->notBefore = std::chrono::steady_clock::now() + delay;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    inFlight--;
+    retried++;
+    pending.push_back(std::move(transfer));
+}
+
+// Requeues a transfer whose token was rejected to wait for the refresh without blocking the loop.
+// Returns false, keeping the transfer, when it does not qualify.
+bool UploadEngine::reauthorize(std::unique_ptr<Transfer>& transfer) {
+    const std::string rejectedToken = transfer->request.getBearerToken();
+    if (transfer->response.status != 401 || transfer->reauthorized || rejectedToken.empty()) {
+        return false;
+    }
+
+    transfer->newToken = GoogleAuth::getInstance().refreshAccessToken(rejectedToken);
+    transfer->reauthorized = true;
+    retry(std::move(transfer), std::chrono::milliseconds(0));
+    return true;
+}
+
+void UploadEngine::complete(std::unique_ptr<Transfer> transfer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight--;
+        completed++;
+        if (transfer->response.timings.reusedConnection) {
+            reusedConnections++;
+        }
+    }
+
+    try {
+        transfer->onComplete(transfer->response);
+    } catch (const std::exception& e) {
+        std::cerr << "Upload callback failed: " << e.what() << std::endl;
+    }
+}
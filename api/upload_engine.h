@@ -0,0 +1,83 @@
+#ifndef UPLOAD_ENGINE_H
+#define UPLOAD_ENGINE_H
+
+#include <chrono>
+#include <cstddef>
+#include <curl/curl.h>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "http_client.h"
+#include "request_scheduler.h"
+
+// Runs requests asynchronously on one curl_multi event loop, keeping a configured number in flight.
+// Transfers to the same host are multiplexed over a single HTTP/2 connection when the server allows it.
+// Each transfer is paced and retried by the request scheduler without blocking the loop, and one
+// rejected for its access token waits for the shared refresh and is sent once more.
+// Requests must be safe to send more than once.
+// An in-memory request body is not copied and must stay valid until the transfer completes.
+class UploadEngine {
+public:
+    using Callback = std::function<void(HttpResponse&)>;
+
+    static UploadEngine& getInstance();
+    // The callback runs on the engine thread, so it should hand off any slow work
+    void submit(RequestScheduler::Api api, const HttpRequest& request, Callback onComplete);
+    std::future<HttpResponse> submit(RequestScheduler::Api api, const HttpRequest& request);
+    void printStats();
+
+private:
+    struct Transfer {
+        HttpRequest request;
+        HttpResponse response;
+        HttpTransfer::HeaderList headerList;
+        FileBody fileBody;
+        Callback onComplete;
+        RequestScheduler::Api api;
+        int attempt;
+        std::chrono::steady_clock::time_point notBefore;
+        // Set while waiting for a token to replace the one the server rejected
+        std::shared_future<std::string> newToken;
+        bool reauthorized;
+
+        Transfer() : headerList(nullptr, curl_slist_free_all), api(RequestScheduler::PHOTOS), attempt(0), reauthorized(false) {}
+    };
+
+    UploadEngine();
+    ~UploadEngine();
+    UploadEngine(const UploadEngine&) = delete;
+    UploadEngine& operator=(const UploadEngine&) = delete;
+
+    void eventLoop();
+    bool startTransfers(long& timeoutMs);
+    void startTransfer(std::unique_ptr<Transfer> transfer);
+    void finishTransfers();
+    void fail(std::unique_ptr<Transfer> transfer, const std::string& error);
+    void retry(std::unique_ptr<Transfer> transfer, std::chrono::milliseconds delay);
+    bool reauthorize(std::unique_ptr<Transfer>& transfer);
+    void complete(std::unique_ptr<Transfer> transfer);
+
+private:
+    CURLM* multi;
+    size_t maxInFlight;
+    std::thread worker;
+
+    // Only touched by the engine thread
+    std::vector<CURL*> idleHandles;
+
+    std::mutex mutex;
+    std::deque<std::unique_ptr<Transfer>> pending;
+    bool stopping;
+    size_t inFlight;
+    size_t peakInFlight;
+    unsigned long completed;
+    unsigned long retried;
+    unsigned long reusedConnections;
+
+};
+
+#endif // UPLOAD_ENGINE_H
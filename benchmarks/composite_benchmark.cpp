@@ -0,0 +1,79 @@
+/*
+Micro-benchmark for the coverage canvas kernels.
+
+Runs blendRow over a 7:9 canvas about 1000px tall, like the images PngTextWriter produces,
+and reports pixels per second for every ISA level this CPU supports.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../core/composite_kernels.h"
+
+const int WIDTH = 778;
+const int HEIGHT = 1000;
+const int ITERATIONS = 200;
+
+// Roughly what a page of text looks like: margins and line gaps are empty,
+// and each line is made of words with partial coverage separated by spaces
+std::vector<uint8_t> makeCoverage() {
+    const int MARGIN = WIDTH / 20;
+    const int LINE_HEIGHT = 160;
+    const int GLYPH_HEIGHT = 139;
+
+    std::vector<uint8_t> coverage((size_t) WIDTH * HEIGHT, 0);
+    std::mt19937 random(42);
+    for (int y = MARGIN; y < HEIGHT - MARGIN; y++) {
+        if ((y - MARGIN) % LINE_HEIGHT >= GLYPH_HEIGHT) {
+            continue;
+        }
+
+        int x = MARGIN;
+        while (x < WIDTH - MARGIN) {
+            int wordEnd = std::min(x + 40 + (int) (random() % 200), WIDTH - MARGIN);
+            for (; x < wordEnd; x++) {
+                if (random() % 2 == 0) {
+                    coverage[(size_t) y * WIDTH + x] = random() % 256;
+                }
+            }
+            x += 28;
+        }
+    }
+    return coverage;
+}
+
+template <typename Kernel>
+double measurePixelsPerSecond(Kernel kernel) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        for (int y = 0; y < HEIGHT; y++) {
+            kernel(y);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (double) WIDTH * HEIGHT * ITERATIONS / elapsed.count();
+}
+
+int main() {
+    std::vector<uint8_t> coverage = makeCoverage();
+    std::vector<uint8_t> canvas((size_t) WIDTH * HEIGHT);
+
+    std::cout << "Canvas " << WIDTH << "x" << HEIGHT << ", " << ITERATIONS << " iterations (Mpixels/s)" << std::endl;
+    for (CompositeKernels::Isa isa : {CompositeKernels::Isa::SCALAR, CompositeKernels::Isa::SSE2, CompositeKernels::Isa::AVX2}) {
+        if (!CompositeKernels::isSupported(isa)) {
+            std::cout << CompositeKernels::getIsaName(isa) << ": not supported" << std::endl;
+            continue;
+        }
+        CompositeKernels::setIsa(isa);
+
+        double blend = measurePixelsPerSecond([&](int y) {
+            CompositeKernels::blendRow(canvas.data() + (size_t) y * WIDTH, coverage.data() + (size_t) y * WIDTH, WIDTH);
+        });
+        std::cout << CompositeKernels::getIsaName(isa) << ": blend " << blend / 1e6 << std::endl;
+    }
+
+    return 0;
+}
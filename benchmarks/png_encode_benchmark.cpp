@@ -0,0 +1,133 @@
+/*
+Benchmark for the PNG output settings.
+
+Draws a page of text with the given font onto a 7:9 canvas about 1000px tall, then encodes it
+with each color mode, filter and compression strategy and reports the output size and encode time.
+A page six times taller is then encoded with and without parallel deflate.
+
+Usage: png_encode_benchmark <font path> [font size]
+*/
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../core/font_manager.h"
+#include "../core/glyph_atlas.h"
+#include "../core/coverage_canvas.h"
+#include "../core/png_encoder.h"
+#include "../utils/string_utils.h"
+
+const int WIDTH = 778;
+const int HEIGHT = 1000;
+const int TALL_HEIGHT = 6 * HEIGHT;
+const int ITERATIONS = 10;
+const std::string TEXT = "The quick brown fox jumps over the lazy dog while a jury of gray quail judges the parade";
+
+void drawText(CoverageCanvas& canvas, SizedFont& font, int startX, int startY, const std::string& text) {
+    // Seeded like PngTextWriter::drawText
+    FT_Vector pen = {0, (FT_Pos) (startY / 64.0)};
+    FT_UInt previousGlyph = 0;
+
+    for (char32_t codepoint : StringUtils::decodeUtf8(text)) {
+        FT_UInt glyphIndex = font.getGlyphIndex(codepoint);
+        if (font.hasKerning() && previousGlyph && glyphIndex) {
+            pen.x += font.getKerning(previousGlyph, glyphIndex);
+        }
+
+        int offsetX;
+        int offsetY;
+        const GlyphBitmap& glyph = GlyphAtlas::getInstance().getGlyph(font, glyphIndex, pen, offsetX, offsetY);
+        int x = startX + glyph.left + offsetX;
+        int y = startY + glyph.top + offsetY;
+        for (int j = 1; j <= glyph.rows; j++) {
+            canvas.blendRow(x + 1, y - j, &glyph.coverage[(j - 1) * glyph.width], glyph.width);
+        }
+
+        pen.x += glyph.advance;
+        previousGlyph = glyphIndex;
+    }
+}
+
+// Fills the canvas with lines of text, wrapping on the canvas width one character at a time
+void drawPage(CoverageCanvas& canvas, SizedFont& font) {
+    const int PAGE_HEIGHT = canvas.getHeight();
+    const int MARGIN = WIDTH / 20;
+    const int LINE_HEIGHT = font.getFontSize() + 40;
+    const size_t CHARACTERS_PER_LINE = (WIDTH - 2 * MARGIN) * 64 / (font.getAdvance(font.getGlyphIndex('n')) + 1);
+
+    size_t offset = 0;
+    for (int y = PAGE_HEIGHT - MARGIN - font.getFontSize(); y > MARGIN; y -= LINE_HEIGHT) {
+        std::string line;
+        while (line.size() < CHARACTERS_PER_LINE) {
+            line += TEXT[offset++ % TEXT.size()];
+        }
+        drawText(canvas, font, MARGIN, y, line);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <font path> [font size]" << std::endl;
+        return 1;
+    }
+    int fontSize = argc > 2 ? std::stoi(argv[2]) : 100;
+
+    std::shared_ptr<SizedFont> font = FontManager::getInstance().getFont(argv[1], fontSize);
+    CoverageCanvas canvas;
+    canvas.resize(WIDTH, HEIGHT);
+    drawPage(canvas, *font);
+
+    const Color fontColor = {1.0, 1.0, 1.0};
+    const Color backgroundColor = {0.0, 0.0, 0.0};
+
+    std::cout << "Canvas " << WIDTH << "x" << HEIGHT << ", " << ITERATIONS << " iterations" << std::endl;
+    std::cout << std::left << std::setw(11) << "mode" << std::setw(10) << "filter" << std::setw(14) << "strategy"
+              << std::setw(7) << "level" << std::setw(10) << "bytes" << "ms" << std::endl;
+
+    for (const std::string colorMode : {"rgb16", "palette", "grayscale"}) {
+        for (const std::string filter : {"none", "up", "adaptive"}) {
+            for (const std::string strategy : {"default", "filtered", "rle"}) {
+                for (int level : {1, 6, 9}) {
+                    PngEncoder::Options options = PngEncoder::parseOptions(colorMode, level, filter, strategy, false);
+
+                    size_t bytes = 0;
+                    auto start = std::chrono::steady_clock::now();
+                    for (int i = 0; i < ITERATIONS; i++) {
+                        bytes = PngEncoder::encode(canvas, fontColor, backgroundColor, options).size();
+                    }
+                    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+                    std::cout << std::setw(11) << colorMode << std::setw(10) << filter << std::setw(14) << strategy
+                              << std::setw(7) << level << std::setw(10) << bytes
+                              << std::fixed << std::setprecision(2) << elapsed.count() / ITERATIONS << std::endl;
+                }
+            }
+        }
+    }
+
+    CoverageCanvas tallCanvas;
+    tallCanvas.resize(WIDTH, TALL_HEIGHT);
+    drawPage(tallCanvas, *font);
+
+    std::cout << std::endl << "Canvas " << WIDTH << "x" << TALL_HEIGHT << ", adaptive filter, default strategy, level 6" << std::endl;
+    std::cout << std::setw(11) << "mode" << std::setw(10) << "parallel" << std::setw(10) << "bytes" << "ms" << std::endl;
+    for (const std::string colorMode : {"rgb16", "palette", "grayscale"}) {
+        for (bool parallelDeflate : {false, true}) {
+            PngEncoder::Options options = PngEncoder::parseOptions(colorMode, 6, "adaptive", "default", parallelDeflate);
+
+            size_t bytes = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < ITERATIONS; i++) {
+                bytes = PngEncoder::encode(tallCanvas, fontColor, backgroundColor, options).size();
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            std::cout << std::setw(11) << colorMode << std::setw(10) << (parallelDeflate ? "yes" : "no") << std::setw(10) << bytes
+                      << std::fixed << std::setprecision(2) << elapsed.count() / ITERATIONS << std::endl;
+        }
+    }
+
+    return 0;
+}
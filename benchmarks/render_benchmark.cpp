@@ -0,0 +1,218 @@
+/*
+Benchmark for PngTextWriter over generated entry corpora.
+
+Every corpus is rendered with each text alignment, first with parallel deflate off as config_example.json
+ships it and then on. After one warm-up pass, the average time per pass is reported for each rendering
+phase along with heap allocations and output bytes, as JSON on stdout so results can be saved and
+compared between releases.
+
+Usage: render_benchmark <font path> [iterations]
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "../core/png_text_writer.h"
+#include "../utils/exif_utils.h"
+
+const int DEFAULT_ITERATIONS = 5;
+const int ENTRIES_PER_CORPUS = 4;
+const std::vector<std::string> ALIGNMENTS = {"left", "center", "right"};
+const std::vector<std::string> WORDS = {
+    "the", "day", "started", "with", "coffee", "and", "a", "long", "walk", "around", "lake", "before", "work",
+    "meeting", "friends", "later", "talked", "about", "plans", "for", "summer", "house", "garden", "book",
+    "finished", "reading", "movie", "night", "early", "tired", "happy", "dinner", "rain", "city", "train"
+};
+const std::vector<std::string> DESCENDER_WORDS = {
+    "jumping", "gypsum", "pygmy", "quaggy", "jiggly", "guppy", "yoga", "quipping", "puppy", "gappy", "joyful", "spying"
+};
+
+std::atomic<unsigned long> allocationCount(0);
+std::atomic<unsigned long> allocatedBytes(0);
+
+// Kept out of line so GCC never sees malloc and free meet the replaced operators, which
+// -Wmismatched-new-delete would flag at every inlined delete
+__attribute__((noinline)) void* countedAllocate(size_t size) {
+    allocationCount++;
+    allocatedBytes += size;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void countedRelease(void* memory) noexcept {
+    std::free(memory);
+}
+
+void* operator new(size_t size) {
+    return countedAllocate(size);
+}
+
+void* operator new[](size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    countedRelease(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    countedRelease(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    countedRelease(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    countedRelease(memory);
+}
+
+struct Corpus {
+    std::string name;
+    std::vector<std::vector<std::string>> entries;
+};
+
+std::string makeParagraph(std::mt19937& random, const std::vector<std::string>& words, int wordCount) {
+    std::string paragraph;
+    for (int i = 0; i < wordCount; i++) {
+        paragraph += (i > 0 ? " " : "") + words.at(random() % words.size());
+    }
+    return paragraph;
+}
+
+std::vector<Corpus> makeCorpora() {
+    std::mt19937 random(7);
+    std::vector<Corpus> corpora = {{"short_title", {}}, {"thousand_word_body", {}}, {"unbreakable_words", {}}, {"descender_heavy", {}}};
+
+    for (int i = 0; i < ENTRIES_PER_CORPUS; i++) {
+        corpora.at(0).entries.push_back({makeParagraph(random, WORDS, 3 + random() % 4)});
+
+        std::vector<std::string> body;
+        for (int paragraph = 0; paragraph < 10; paragraph++) {
+            body.push_back(makeParagraph(random, WORDS, 100));
+        }
+        corpora.at(1).entries.push_back(body);
+
+        std::string longWord;
+        for (int part = 0; part < 4; part++) {
+            longWord += WORDS.at(random() % WORDS.size());
+        }
+        corpora.at(2).entries.push_back({longWord + " " + makeParagraph(random, WORDS, 8) + " " + longWord});
+
+        corpora.at(3).entries.push_back({makeParagraph(random, DESCENDER_WORDS, 40), makeParagraph(random, DESCENDER_WORDS, 40)});
+    }
+
+    return corpora;
+}
+
+struct CaseResult {
+    RenderTimings timings;
+    double exifMs = 0;
+    double totalMs = 0;
+    unsigned long allocations = 0;
+    unsigned long bytesAllocated = 0;
+    size_t outputBytes = 0;
+    int maxImageHeight = 0;
+};
+
+// Renders every entry in the corpus once and adds the results to the totals
+void renderCorpus(const Corpus& corpus, const RenderOptions& options, CaseResult& result) {
+    unsigned long allocationsBefore = allocationCount;
+    unsigned long bytesBefore = allocatedBytes;
+    auto passStart = std::chrono::steady_clock::now();
+
+    for (const std::vector<std::string>& paragraphs : corpus.entries) {
+        auto exifStart = std::chrono::steady_clock::now();
+        std::string exifData = ExifUtils::buildOriginalDateExif("2025:05:09 22:34:00", "-07:00");
+        result.exifMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - exifStart).count();
+
+        PngTextWriter writer(paragraphs, "benchmark.png", options);
+        result.outputBytes += writer.renderImage(exifData).size();
+        result.maxImageHeight = std::max(result.maxImageHeight, writer.getHeight());
+
+        const RenderTimings& timings = writer.getTimings();
+        result.timings.measureMs += timings.measureMs;
+        result.timings.layoutMs += timings.layoutMs;
+        result.timings.drawMs += timings.drawMs;
+        result.timings.encodeMs += timings.encodeMs;
+    }
+
+    result.totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - passStart).count();
+    result.allocations += allocationCount - allocationsBefore;
+    result.bytesAllocated += allocatedBytes - bytesBefore;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <font path> [iterations]" << std::endl;
+        return 1;
+    }
+    int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : DEFAULT_ITERATIONS;
+
+    RenderOptions options;
+    options.fontPath = argv[1];
+    options.fontSize = 100;
+    options.fontColor = {1.0, 1.0, 1.0};
+    options.aspectRatioWidth = 7;
+    options.aspectRatioHeight = 9;
+    options.margins = 0.05;
+    options.alwaysUseDescenderSpacing = true;
+    options.paginate = false;
+    options.showLineBorders = false;
+    options.useRenderCache = false;
+
+    nlohmann::json report;
+    report["font_path"] = options.fontPath;
+    report["font_size"] = options.fontSize;
+    report["iterations"] = iterations;
+    report["entries_per_corpus"] = ENTRIES_PER_CORPUS;
+    report["cases"] = nlohmann::json::array();
+
+    for (const Corpus& corpus : makeCorpora()) {
+        for (const std::string& alignment : ALIGNMENTS) {
+            for (bool parallelDeflate : {false, true}) {
+                options.textAlignment = alignment;
+                options.pngOptions = PngEncoder::parseOptions("palette", 6, "none", "rle", parallelDeflate);
+
+                // The first pass fills the glyph caches, so it is not counted
+                CaseResult warmUp;
+                renderCorpus(corpus, options, warmUp);
+
+                CaseResult result;
+                for (int i = 0; i < iterations; i++) {
+                    renderCorpus(corpus, options, result);
+                }
+
+                nlohmann::json phases;
+                phases["measure"] = result.timings.measureMs / iterations;
+                phases["layout"] = result.timings.layoutMs / iterations;
+                phases["draw"] = result.timings.drawMs / iterations;
+                phases["encode"] = result.timings.encodeMs / iterations;
+                phases["exif"] = result.exifMs / iterations;
+
+                nlohmann::json benchmarkCase;
+                benchmarkCase["corpus"] = corpus.name;
+                benchmarkCase["alignment"] = alignment;
+                benchmarkCase["parallel_deflate"] = parallelDeflate;
+                benchmarkCase["phases_ms"] = phases;
+                benchmarkCase["total_ms"] = result.totalMs / iterations;
+                benchmarkCase["allocations"] = result.allocations / iterations;
+                benchmarkCase["allocated_bytes"] = result.bytesAllocated / iterations;
+                benchmarkCase["output_bytes"] = result.outputBytes / iterations;
+                benchmarkCase["max_image_height"] = result.maxImageHeight;
+                report["cases"].push_back(benchmarkCase);
+            }
+        }
+    }
+
+    std::cout << report.dump(4) << std::endl;
+    return 0;
+}
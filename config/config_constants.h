@@ -12,6 +12,8 @@ namespace ConfigConstants {
     const std::string CLIENT_SECRET = "client_secret";
     const std::string REDIRECT_URI = "redirect_uri";
     const std::string REFRESH_TOKEN = "refresh_token";
+    const std::string ACCESS_TOKEN = "access_token";
+    const std::string ACCESS_TOKEN_EXPIRY = "access_token_expiry";
 
     const std::string SETTINGS = "settings";
     const std::string FONT_PATH = "font_path";
@@ -31,9 +33,41 @@ namespace ConfigConstants {
     const std::string GOOGLE_DOC_ID = "google_doc_id";
     const std::string GOOGLE_SHEET_ID = "google_sheet_id";
     const std::string PHOTOS_DESCRIPTION_CHAR_LIMIT = "photos_description_char_limit";
+    const std::string PAGINATE_LONG_ENTRIES = "paginate_long_entries";
+    const std::string PIPELINE = "pipeline";
+    const std::string RENDER_THREADS = "render_threads";
+    const std::string QUEUE_CAPACITY = "queue_capacity";
+    const std::string MAX_IN_FLIGHT_IMAGE_MB = "max_in_flight_image_mb";
+    const std::string PNG_OUTPUT = "png_output";
+    const std::string COLOR_MODE = "color_mode";
+    const std::string COMPRESSION_LEVEL = "compression_level";
+    const std::string FILTER = "filter";
+    const std::string STRATEGY = "strategy";
+    const std::string PARALLEL_DEFLATE = "parallel_deflate";
+    const std::string RENDER_CACHE = "render_cache";
+    const std::string ENABLED = "enabled";
+    const std::string DIRECTORY = "directory";
+    const std::string MAX_SIZE_MB = "max_size_mb";
+    const std::string UPLOADS = "uploads";
+    const std::string MAX_IN_FLIGHT = "max_in_flight";
+    const std::string UPLOAD_URL = "upload_url";
+    const std::string RESUMABLE_THRESHOLD_KB = "resumable_threshold_kb";
+    const std::string RESUMABLE_CHUNK_KB = "resumable_chunk_kb";
+    const std::string MAX_RESUME_ATTEMPTS = "max_resume_attempts";
+    const std::string RATE_LIMITS = "rate_limits";
+    const std::string MAX_RETRIES = "max_retries";
+    const std::string BASE_BACKOFF_MS = "base_backoff_ms";
+    const std::string MAX_BACKOFF_MS = "max_backoff_ms";
+    const std::string REQUESTS_PER_SECOND = "requests_per_second";
+    const std::string BURST = "burst";
+    const std::string MAX_CONCURRENCY = "max_concurrency";
+    const std::string SHEETS = "sheets";
+    const std::string INSERT_MODE = "insert_mode";
+    const std::string SHARD_BY = "shard_by";
 
     const std::string DEBUG_SETTINGS = "debug_settings";
     const std::string SHOW_LINE_BORDERS = "show_line_borders";
+    const std::string WRITE_IMAGES_TO_DISK = "write_images_to_disk";
 
 } 
 
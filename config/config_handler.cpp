@@ -1,10 +1,14 @@
 #include "config_handler.h"
+#include <filesystem>
+#include <iomanip>
 #include <fstream>
 #include <stdexcept>
 #include <iostream>
 
 namespace ConfigConst = ConfigConstants;
 
+const std::string TEMPORARY_EXTENSION = ".tmp";
+
 ConfigHandler& ConfigHandler::getInstance() {
     static ConfigHandler instance;
     return instance;
@@ -26,15 +30,35 @@ void ConfigHandler::loadConfig(const std::string& filePath) {
     std::cout << "Configuration loading completed successfully." << std::endl;
 }
 
+void ConfigHandler::setConfigValues(const std::string& section, const nlohmann::json& values) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    nlohmann::json& current = configData[section];
+    for (auto itor = values.begin(); itor != values.end(); ++itor) {
+        current[itor.key()] = itor.value();
+    }
+
+    writeJson();
+}
+
+// Callers hold the lock exclusively
 void ConfigHandler::writeJson() {
     const int JSON_INDENT = 4;
-    std::ofstream outputFile(ConfigConst::CONFIG_FILE_PATH);
-    if (outputFile.is_open()) {
-        outputFile << std::setw(JSON_INDENT) << configData << std::endl;
-        outputFile.close();
-        std::cout << "JSON data written to config.json" << std::endl;
-    } else {
-        std::cerr << "Error opening file for writing" << std::endl;
+    const std::string temporaryPath = ConfigConst::CONFIG_FILE_PATH + TEMPORARY_EXTENSION;
+
+    try {
+        {
+            std::ofstream outputFile(temporaryPath);
+            outputFile << std::setw(JSON_INDENT) << configData << std::endl;
+            if (!outputFile) {
+                throw std::runtime_error("Unable to write " + temporaryPath);
+            }
+        }
+        // Renaming over the old file means a crash never leaves a truncated config behind
+        std::filesystem::rename(temporaryPath, ConfigConst::CONFIG_FILE_PATH);
+    } catch (const std::exception& e) {
+        std::cerr << "Error writing config file: " << e.what() << std::endl;
+        std::error_code error;
+        std::filesystem::remove(temporaryPath, error);
     }
 }
 
@@ -2,10 +2,12 @@
 #define CONFIG_HANDLER_H
 
 #include <string>
+#include <shared_mutex>
 #include <nlohmann/json.hpp>
 
 #include "config_constants.h"
 
+// Safe to use from any thread: reads share a lock and writes take it exclusively
 class ConfigHandler {
 public:
     static ConfigHandler& getInstance();
@@ -18,6 +20,9 @@ public:
     template <typename... Keys>
     void setConfigValue(Keys&&... keys);
 
+    // Sets every key in values under the given section at once, with a single write
+    void setConfigValues(const std::string& section, const nlohmann::json& values);
+
 private:
     ConfigHandler();
     ConfigHandler(const ConfigHandler&) = delete;
@@ -27,6 +32,7 @@ private:
 
 private:
     nlohmann::json configData;
+    mutable std::shared_mutex mutex;
 
 };
 
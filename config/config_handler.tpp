@@ -1,8 +1,10 @@
+#include <mutex>
 #include <stdexcept>
 
 // Get a configuration value by traversing keys (only string keys are valid)
 template <typename... Keys>
 nlohmann::json ConfigHandler::getConfigValue(Keys&&... keys) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
     const nlohmann::json* current = &configData;
 
     auto traverse = [&](const std::string& key) {
@@ -26,6 +28,7 @@ void ConfigHandler::setConfigValue(Keys&&... keys) {
         throw std::invalid_argument("At least two arguments are required: a key and a value.");
     }
 
+    std::unique_lock<std::shared_mutex> lock(mutex);
     nlohmann::json* current = &configData;
 
     auto traverse = [&](const std::string& key) {
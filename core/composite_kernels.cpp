@@ -0,0 +1,162 @@
+#include "composite_kernels.h"
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define COMPOSITE_KERNELS_X86
+    #include <immintrin.h>
+#endif
+
+namespace {
+
+    const size_t RGB16_BYTES = 6;
+
+    // x / 255 rounded to nearest for x <= 255 * 255, without a division
+    inline uint16_t divideBy255(uint16_t x) {
+        x += 127;
+        return (x + 1 + (x >> 8)) >> 8;
+    }
+
+    void blendRowScalar(uint8_t* destination, const uint8_t* coverage, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            destination[i] = destination[i] + divideBy255((255 - destination[i]) * coverage[i]);
+        }
+    }
+
+#ifdef COMPOSITE_KERNELS_X86
+
+    __attribute__((target("sse2")))
+    inline __m128i divideBy255Sse2(__m128i x) {
+        x = _mm_add_epi16(x, _mm_set1_epi16(127));
+        return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+    }
+
+    __attribute__((target("sse2")))
+    void blendRowSse2(uint8_t* destination, const uint8_t* coverage, size_t count) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i full = _mm_set1_epi16(255);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i canvas = _mm_loadu_si128((const __m128i*) (destination + i));
+            __m128i glyph = _mm_loadu_si128((const __m128i*) (coverage + i));
+
+            __m128i canvasLow = _mm_unpacklo_epi8(canvas, zero);
+            __m128i canvasHigh = _mm_unpackhi_epi8(canvas, zero);
+            __m128i glyphLow = _mm_unpacklo_epi8(glyph, zero);
+            __m128i glyphHigh = _mm_unpackhi_epi8(glyph, zero);
+
+            canvasLow = _mm_add_epi16(canvasLow, divideBy255Sse2(_mm_mullo_epi16(_mm_sub_epi16(full, canvasLow), glyphLow)));
+            canvasHigh = _mm_add_epi16(canvasHigh, divideBy255Sse2(_mm_mullo_epi16(_mm_sub_epi16(full, canvasHigh), glyphHigh)));
+
+            _mm_storeu_si128((__m128i*) (destination + i), _mm_packus_epi16(canvasLow, canvasHigh));
+        }
+        blendRowScalar(destination + i, coverage + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i divideBy255Avx2(__m256i x) {
+        x = _mm256_add_epi16(x, _mm256_set1_epi16(127));
+        return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8)), 8);
+    }
+
+    __attribute__((target("avx2")))
+    void blendRowAvx2(uint8_t* destination, const uint8_t* coverage, size_t count) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i full = _mm256_set1_epi16(255);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i canvas = _mm256_loadu_si256((const __m256i*) (destination + i));
+            __m256i glyph = _mm256_loadu_si256((const __m256i*) (coverage + i));
+
+            // Unpacking and packing both work within 128-bit lanes, so byte order is preserved
+            __m256i canvasLow = _mm256_unpacklo_epi8(canvas, zero);
+            __m256i canvasHigh = _mm256_unpackhi_epi8(canvas, zero);
+            __m256i glyphLow = _mm256_unpacklo_epi8(glyph, zero);
+            __m256i glyphHigh = _mm256_unpackhi_epi8(glyph, zero);
+
+            canvasLow = _mm256_add_epi16(canvasLow, divideBy255Avx2(_mm256_mullo_epi16(_mm256_sub_epi16(full, canvasLow), glyphLow)));
+            canvasHigh = _mm256_add_epi16(canvasHigh, divideBy255Avx2(_mm256_mullo_epi16(_mm256_sub_epi16(full, canvasHigh), glyphHigh)));
+
+            _mm256_storeu_si256((__m256i*) (destination + i), _mm256_packus_epi16(canvasLow, canvasHigh));
+        }
+        blendRowSse2(destination + i, coverage + i, count - i);
+    }
+
+#endif
+
+    struct Kernels {
+        CompositeKernels::Isa isa;
+        void (*blendRow)(uint8_t*, const uint8_t*, size_t);
+    };
+
+    Kernels kernelsFor(CompositeKernels::Isa isa) {
+        switch (isa) {
+#ifdef COMPOSITE_KERNELS_X86
+            case CompositeKernels::Isa::AVX2:
+                return {isa, blendRowAvx2};
+            case CompositeKernels::Isa::SSE2:
+                return {isa, blendRowSse2};
+#endif
+            default:
+                return {CompositeKernels::Isa::SCALAR, blendRowScalar};
+        }
+    }
+
+    Kernels& activeKernels() {
+        static Kernels kernels = kernelsFor(CompositeKernels::isSupported(CompositeKernels::Isa::AVX2) ? CompositeKernels::Isa::AVX2
+            : CompositeKernels::isSupported(CompositeKernels::Isa::SSE2) ? CompositeKernels::Isa::SSE2
+            : CompositeKernels::Isa::SCALAR);
+        return kernels;
+    }
+
+}
+
+CompositeKernels::Isa CompositeKernels::getIsa() {
+    return activeKernels().isa;
+}
+
+bool CompositeKernels::isSupported(Isa isa) {
+    switch (isa) {
+        case Isa::SCALAR:
+            return true;
+#ifdef COMPOSITE_KERNELS_X86
+        case Isa::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case Isa::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+// Overrides the detected ISA level, used to compare levels. Unsupported levels fall back to scalar.
+void CompositeKernels::setIsa(Isa isa) {
+    activeKernels() = kernelsFor(isSupported(isa) ? isa : Isa::SCALAR);
+}
+
+const char* CompositeKernels::getIsaName(Isa isa) {
+    switch (isa) {
+        case Isa::SSE2:
+            return "sse2";
+        case Isa::AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+// libc's memset is already vectorized and beats hand-written stores at these sizes
+void CompositeKernels::fillRow(uint8_t* destination, uint8_t value, size_t count) {
+    memset(destination, value, count);
+}
+
+void CompositeKernels::blendRow(uint8_t* destination, const uint8_t* coverage, size_t count) {
+    activeKernels().blendRow(destination, coverage, count);
+}
+
+// A table lookup per pixel; SSE2/AVX2 versions measured no faster, since each pixel is a 6-byte copy
+void CompositeKernels::colorizeRow(uint8_t* destination, const uint8_t* coverage, size_t count, const ColorRamp& ramp) {
+    for (size_t i = 0; i < count; i++) {
+        memcpy(destination + i * RGB16_BYTES, ramp.pixels[coverage[i]], RGB16_BYTES);
+    }
+}
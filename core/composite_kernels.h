@@ -0,0 +1,33 @@
+#ifndef COMPOSITE_KERNELS_H
+#define COMPOSITE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Per-pixel loops for the coverage canvas. blendRow has SSE2/AVX2 versions picked at runtime,
+// and every ISA level produces bit-identical results to the scalar fallback.
+namespace CompositeKernels {
+
+    enum class Isa {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    // 16-bit big-endian RGB for each coverage value
+    struct ColorRamp {
+        uint8_t pixels[256][6];
+    };
+
+    Isa getIsa();
+    bool isSupported(Isa isa);
+    void setIsa(Isa isa);
+    const char* getIsaName(Isa isa);
+
+    void fillRow(uint8_t* destination, uint8_t value, size_t count);
+    void blendRow(uint8_t* destination, const uint8_t* coverage, size_t count);
+    void colorizeRow(uint8_t* destination, const uint8_t* coverage, size_t count, const ColorRamp& ramp);
+
+}
+
+#endif // COMPOSITE_KERNELS_H
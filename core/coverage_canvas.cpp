@@ -0,0 +1,54 @@
+#include "coverage_canvas.h"
+#include <algorithm>
+#include "composite_kernels.h"
+
+CoverageCanvas::CoverageCanvas() {
+    width = 0;
+    height = 0;
+}
+
+// Clears the canvas. Storage is only reallocated when the canvas grows past its capacity.
+void CoverageCanvas::resize(int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+    pixels.resize((size_t) width * height);
+    CompositeKernels::fillRow(pixels.data(), 0, pixels.size());
+    outlines.clear();
+}
+
+int CoverageCanvas::getWidth() const {
+    return width;
+}
+
+int CoverageCanvas::getHeight() const {
+    return height;
+}
+
+// Composites a run of coverage starting at (x, y) and moving right, clipped to the canvas.
+// This is the same as blending the font colour over the image.
+void CoverageCanvas::blendRow(int x, int y, const uint8_t* coverage, int count) {
+    if (y < 1 || y > height) {
+        return;
+    }
+
+    int first = std::max(x, 1);
+    int last = std::min(x + count - 1, width);
+    if (first > last) {
+        return;
+    }
+
+    CompositeKernels::blendRow(&pixels[(size_t) (height - y) * width + (first - 1)], coverage + (first - x), last - first + 1);
+}
+
+// Outlines are kept apart from the coverage and painted in the debug colour when the image is encoded
+void CoverageCanvas::addOutline(int startX, int startY, int endX, int endY) {
+    outlines.push_back({std::min(startX, endX), std::min(startY, endY), std::max(startX, endX), std::max(startY, endY)});
+}
+
+const uint8_t* CoverageCanvas::getRow(int rowFromTop) const {
+    return pixels.data() + (size_t) rowFromTop * width;
+}
+
+const std::vector<CoverageCanvas::Outline>& CoverageCanvas::getOutlines() const {
+    return outlines;
+}
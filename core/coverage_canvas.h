@@ -0,0 +1,41 @@
+#ifndef COVERAGE_CANVAS_H
+#define COVERAGE_CANVAS_H
+
+#include <cstdint>
+#include <vector>
+
+struct Color {
+    float red;
+    float green;
+    float blue;
+};
+
+// Single colour drawing surface storing one byte of text coverage per pixel.
+// Coordinates follow pngwriter: 1-based with the origin at the bottom left.
+class CoverageCanvas {
+public:
+    struct Outline {
+        int startX;
+        int startY;
+        int endX;
+        int endY;
+    };
+
+    CoverageCanvas();
+    void resize(int newWidth, int newHeight);
+    int getWidth() const;
+    int getHeight() const;
+    void blendRow(int x, int y, const uint8_t* coverage, int count);
+    void addOutline(int startX, int startY, int endX, int endY);
+    const uint8_t* getRow(int rowFromTop) const;
+    const std::vector<Outline>& getOutlines() const;
+
+private:
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+    std::vector<Outline> outlines;
+
+};
+
+#endif // COVERAGE_CANVAS_H
@@ -59,6 +59,10 @@ std::string Entry::toFilename() {
     return generatedId + ".png";
 }
 
+std::string Entry::toPageFilename(int pageNumber) {
+    return generatedId + "_" + std::to_string(pageNumber) + ".png";
+}
+
 std::string Entry::toTimestamp() {
     return date + "T" + time + timeOffset;
 }
@@ -18,6 +18,7 @@ public:
     std::vector<std::string> getBody();
     std::string getEntryType();
     std::string toFilename();
+    std::string toPageFilename(int pageNumber);
     std::string toTimestamp();
     std::string getExifDatetime();
     std::string getFirstNCharsFromParagraphs(const std::vector<std::string>& paragraphs, int charsNeeded);
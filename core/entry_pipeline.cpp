@@ -0,0 +1,256 @@
+#include "entry_pipeline.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include "../config/config_handler.h"
+#include "../utils/exif_utils.h"
+#include "../utils/file_utils.h"
+
+namespace ConfigConst = ConfigConstants;
+
+const size_t BYTES_PER_MB = 1024 * 1024;
+
+EntryPipeline::Settings EntryPipeline::Settings::fromConfig() {
+    Settings settings;
+    ConfigHandler& config = ConfigHandler::getInstance();
+
+    settings.renderThreads = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PIPELINE, ConfigConst::RENDER_THREADS);
+    settings.queueCapacity = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PIPELINE, ConfigConst::QUEUE_CAPACITY);
+    settings.maxInFlightBytes = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PIPELINE, ConfigConst::MAX_IN_FLIGHT_IMAGE_MB).get<size_t>() * BYTES_PER_MB;
+    settings.writeImagesToDisk = config.getConfigValue(ConfigConst::DEBUG_SETTINGS, ConfigConst::WRITE_IMAGES_TO_DISK);
+
+    // 0 render threads means one per core
+    if (settings.renderThreads == 0) {
+        settings.renderThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    return settings;
+}
+
+EntryPipeline::EntryPipeline(const std::string& projectPath, GoogleAPIHandler& googleAPIHandler, const Settings& settings, const RenderOptions& renderOptions)
+    : projectPath(projectPath),
+      googleAPIHandler(googleAPIHandler),
+      settings(settings),
+      renderOptions(renderOptions),
+      renderQueue(settings.queueCapacity),
+      uploadQueue(settings.queueCapacity),
+      mediaItemQueue(settings.queueCapacity),
+      sheetQueue(settings.queueCapacity),
+      imageBytes(settings.maxInFlightBytes),
+      activeRenderers(settings.renderThreads) {}
+
+// Rethrows the first error any stage hit, after every stage has stopped
+void EntryPipeline::run(const std::function<std::vector<Entry>()>& extractEntries) {
+    std::vector<std::thread> threads;
+    threads.emplace_back([this, &extractEntries]() { runStage([this, &extractEntries]() { extractStage(extractEntries); }); });
+    for (unsigned int i = 0; i < settings.renderThreads; i++) {
+        threads.emplace_back([this]() { runStage([this]() { renderStage(); }); });
+    }
+    threads.emplace_back([this]() { runStage([this]() { uploadStage(); }); });
+    threads.emplace_back([this]() { runStage([this]() { mediaItemStage(); }); });
+
+    runStage([this]() { sheetStage(); });
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::cout << "Peak rendered image bytes waiting for upload: " << imageBytes.getPeakBytes() << std::endl;
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+void EntryPipeline::extractStage(const std::function<std::vector<Entry>()>& extractEntries) {
+    entries = extractEntries();
+    std::cout << "Extracted " << entries.size() << " entries" << std::endl;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!renderQueue.push(i)) {
+            return;
+        }
+    }
+    renderQueue.close();
+}
+
+void EntryPipeline::renderStage() {
+    size_t index;
+    while (renderQueue.pop(index)) {
+        Entry& entry = entries.at(index);
+        std::string exifData = settings.writeImagesToDisk ? "" : ExifUtils::buildOriginalDateExif(entry.getExifDatetime(), entry.getTimeOffset());
+        PngTextWriter pngTextWriter(entry.getTitle(), entry.toFilename(), renderOptions);
+
+        UploadJob job;
+        job.index = index;
+        job.pages = pngTextWriter.renderPages(exifData);
+        job.bytes = 0;
+        for (const std::string& page : job.pages) {
+            job.bytes += page.size();
+        }
+
+        // Waits here while the upload stage is too far behind
+        if (!imageBytes.acquire(job.bytes)) {
+            return;
+        }
+        size_t bytes = job.bytes;
+        if (!uploadQueue.push(std::move(job))) {
+            imageBytes.release(bytes);
+            return;
+        }
+    }
+
+    // The last renderer to finish ends the upload stage's input
+    if (--activeRenderers == 0) {
+        uploadQueue.close();
+    }
+}
+
+// Only starts the uploads, so the next entry can begin while earlier ones are still sending
+void EntryPipeline::uploadStage() {
+    UploadJob job;
+    while (uploadQueue.pop(job)) {
+        Entry& entry = entries.at(job.index);
+
+        std::ostringstream message;
+        message << std::endl << "Processing entry " << job.index + 1 << " of " << entries.size() << std::endl;
+        std::cout << message.str();
+
+        startUploads(entry, job);
+        if (!mediaItemQueue.push(std::move(job))) {
+            return;
+        }
+    }
+
+    mediaItemQueue.close();
+}
+
+// Gathers finished uploads so their media items are created with as few batchCreate calls as possible
+void EntryPipeline::mediaItemStage() {
+    std::vector<UploadJob> batch;
+    std::vector<GooglePhotosAPI::NewMediaItem> items;
+
+    UploadJob job;
+    while (mediaItemQueue.pop(job)) {
+        Entry& entry = entries.at(job.index);
+        const size_t pageCount = job.uploadTokens.size();
+
+        // Keeps every page of an entry in the same call
+        if (!items.empty() && items.size() + pageCount > GooglePhotosAPI::MAX_BATCH_CREATE_ITEMS) {
+            if (!flushMediaItems(batch, items)) {
+                return;
+            }
+        }
+
+        for (size_t i = 0; i < pageCount; i++) {
+            std::string filename = (pageCount > 1) ? entry.toPageFilename(i + 1) : entry.toFilename();
+            items.push_back({job.uploadTokens.at(i).get(), filename, entry.generatePhotosDescription()});
+        }
+        for (const std::string& filename : job.diskFiles) {
+            FileUtils::deleteFile(filename);
+        }
+        imageBytes.release(job.bytes);
+        batch.push_back(std::move(job));
+    }
+
+    if (hasFailed() || !flushMediaItems(batch, items)) {
+        return;
+    }
+    sheetQueue.close();
+}
+
+// Rows arrive in whatever order uploads finish and are put back in entry order before appending
+void EntryPipeline::sheetStage() {
+    std::map<size_t, std::vector<std::string>> rows;
+    SheetRow row;
+    while (sheetQueue.pop(row)) {
+        rows[row.index] = std::move(row.row);
+    }
+
+    if (hasFailed()) {
+        return;
+    }
+
+    std::vector<std::vector<std::string>> rowEntries;
+    for (auto& entryRow : rows) {
+        rowEntries.push_back(std::move(entryRow.second));
+    }
+    googleAPIHandler.appendRowsToSheet(rowEntries);
+}
+
+// Images written to disk are streamed from their files, so their memory is freed straight away
+void EntryPipeline::startUploads(Entry& entry, UploadJob& job) {
+    for (size_t i = 0; i < job.pages.size(); i++) {
+        if (settings.writeImagesToDisk) {
+            std::string filename = (job.pages.size() > 1) ? entry.toPageFilename(i + 1) : entry.toFilename();
+            FileUtils::writeFile(filename, job.pages.at(i));
+            FileUtils::updateExifOriginalDate(projectPath + filename, entry.getExifDatetime(), entry.getTimeOffset());
+            job.uploadTokens.push_back(googleAPIHandler.startPhotoFileUpload(projectPath + filename));
+            job.diskFiles.push_back(filename);
+        } else {
+            std::shared_ptr<const std::string> page = std::make_shared<const std::string>(std::move(job.pages.at(i)));
+            job.uploadTokens.push_back(googleAPIHandler.startPhotoUpload(page));
+        }
+    }
+    job.pages.clear();
+
+    if (settings.writeImagesToDisk) {
+        imageBytes.release(job.bytes);
+        job.bytes = 0;
+    }
+}
+
+// Items are in batch order, with each entry's pages consecutive
+bool EntryPipeline::flushMediaItems(std::vector<UploadJob>& batch, std::vector<GooglePhotosAPI::NewMediaItem>& items) {
+    std::vector<std::string> photosIds = googleAPIHandler.finishPhotoUploads(items);
+
+    size_t item = 0;
+    for (UploadJob& job : batch) {
+        std::string photosId;
+        for (size_t page = 0; page < job.uploadTokens.size(); page++, item++) {
+            photosId += (page > 0 ? "|" : "") + photosIds.at(item);
+        }
+
+        Entry& entry = entries.at(job.index);
+        entry.setPhotosId(photosId);
+        if (!sheetQueue.push({job.index, entry.toVector()})) {
+            return false;
+        }
+    }
+
+    batch.clear();
+    items.clear();
+    return true;
+}
+
+void EntryPipeline::runStage(const std::function<void()>& stage) {
+    try {
+        stage();
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+bool EntryPipeline::hasFailed() {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return firstError != nullptr;
+}
+
+// Stops every stage: blocked pushes and pops return false and queued work is dropped
+void EntryPipeline::fail(std::exception_ptr error) {
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!firstError) {
+            firstError = error;
+        }
+    }
+
+    renderQueue.cancel();
+    uploadQueue.cancel();
+    mediaItemQueue.cancel();
+    sheetQueue.cancel();
+    imageBytes.close();
+}
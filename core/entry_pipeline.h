@@ -0,0 +1,85 @@
+#ifndef ENTRY_PIPELINE_H
+#define ENTRY_PIPELINE_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "entry.h"
+#include "png_text_writer.h"
+#include "../api/google_api_handler.h"
+#include "../utils/bounded_queue.h"
+#include "../utils/byte_budget.h"
+
+// Extracts, renders, uploads and collects sheet rows as concurrent stages joined by bounded queues,
+// so rendering one entry overlaps the upload of the one before it. Uploads of many entries run at
+// once on the upload engine. Rendered images that are not uploaded yet are limited by total size,
+// and sheet rows are appended in extraction order.
+class EntryPipeline {
+public:
+    struct Settings {
+        unsigned int renderThreads;
+        size_t queueCapacity;
+        size_t maxInFlightBytes;
+        bool writeImagesToDisk;
+
+        static Settings fromConfig();
+    };
+
+    EntryPipeline(const std::string& projectPath, GoogleAPIHandler& googleAPIHandler, const Settings& settings, const RenderOptions& renderOptions);
+    void run(const std::function<std::vector<Entry>()>& extractEntries);
+
+private:
+    struct UploadJob {
+        size_t index;
+        std::vector<std::string> pages;
+        size_t bytes;
+        // One per page, filled in once the uploads have started
+        std::vector<std::future<std::string>> uploadTokens;
+        // Written images, deleted once their uploads finish
+        std::vector<std::string> diskFiles;
+    };
+
+    struct SheetRow {
+        size_t index;
+        std::vector<std::string> row;
+    };
+
+    EntryPipeline(const EntryPipeline&) = delete;
+    EntryPipeline& operator=(const EntryPipeline&) = delete;
+
+    void extractStage(const std::function<std::vector<Entry>()>& extractEntries);
+    void renderStage();
+    void uploadStage();
+    void mediaItemStage();
+    void sheetStage();
+    void startUploads(Entry& entry, UploadJob& job);
+    bool flushMediaItems(std::vector<UploadJob>& batch, std::vector<GooglePhotosAPI::NewMediaItem>& items);
+    void runStage(const std::function<void()>& stage);
+    void fail(std::exception_ptr error);
+    bool hasFailed();
+
+private:
+    std::string projectPath;
+    GoogleAPIHandler& googleAPIHandler;
+    Settings settings;
+    RenderOptions renderOptions;
+
+    // Filled by the extract stage before any index is queued, then only read
+    std::vector<Entry> entries;
+    BoundedQueue<size_t> renderQueue;
+    BoundedQueue<UploadJob> uploadQueue;
+    BoundedQueue<UploadJob> mediaItemQueue;
+    BoundedQueue<SheetRow> sheetQueue;
+    ByteBudget imageBytes;
+    std::atomic<unsigned int> activeRenderers;
+
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+
+};
+
+#endif // ENTRY_PIPELINE_H
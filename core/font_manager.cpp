@@ -0,0 +1,167 @@
+#include "font_manager.h"
+#include <iostream>
+#include <stdexcept>
+#include "../config/config_handler.h"
+
+namespace ConfigConst = ConfigConstants;
+
+// pngwriter sets the character size at 100 dpi in both directions
+const int FONT_DPI = 100;
+
+FontFace::~FontFace() {
+    if (face) {
+        FT_Done_Face(face);
+    }
+}
+
+SizedFont::SizedFont(const std::shared_ptr<FontFace>& fontFace, int fontSize) {
+    this->fontFace = fontFace;
+    this->fontSize = fontSize;
+
+    std::lock_guard<std::mutex> lock(fontFace->mutex);
+    if (FT_New_Size(fontFace->face, &size) != 0) {
+        throw std::runtime_error("Unable to create font size: " + std::to_string(fontSize));
+    }
+    FT_Activate_Size(size);
+    FT_Set_Char_Size(fontFace->face, fontSize * 64, fontSize * 64, FONT_DPI, FONT_DPI);
+    useKerning = FT_HAS_KERNING(fontFace->face);
+}
+
+SizedFont::~SizedFont() {
+    std::lock_guard<std::mutex> lock(fontFace->mutex);
+    FT_Done_Size(size);
+}
+
+int SizedFont::getFontSize() const {
+    return fontSize;
+}
+
+bool SizedFont::hasKerning() const {
+    return useKerning;
+}
+
+FT_UInt SizedFont::getGlyphIndex(char32_t codepoint) {
+    std::lock_guard<std::mutex> lock(fontFace->mutex);
+    return FT_Get_Char_Index(fontFace->face, codepoint);
+}
+
+FT_Pos SizedFont::getAdvance(FT_UInt glyphIndex) {
+    std::lock_guard<std::mutex> lock(fontFace->mutex);
+    FT_Activate_Size(size);
+
+    if (FT_Load_Glyph(fontFace->face, glyphIndex, FT_LOAD_DEFAULT) != 0) {
+        std::cerr << "Unable to load glyph " << glyphIndex << std::endl;
+        return 0;
+    }
+
+    return fontFace->face->glyph->advance.x;
+}
+
+FT_Pos SizedFont::getKerning(FT_UInt previousGlyph, FT_UInt glyph) {
+    std::lock_guard<std::mutex> lock(fontFace->mutex);
+    FT_Activate_Size(size);
+
+    FT_Vector delta;
+    FT_Get_Kerning(fontFace->face, previousGlyph, glyph, FT_KERNING_DEFAULT, &delta);
+    return delta.x;
+}
+
+// Renders the glyph offset by the pen position, the same way pngwriter::plot_text_utf8 does
+GlyphBitmap SizedFont::renderGlyph(FT_UInt glyphIndex, FT_Vector pen) {
+    std::lock_guard<std::mutex> lock(fontFace->mutex);
+    FT_Activate_Size(size);
+
+    GlyphBitmap glyph = {0, 0, 0, 0, 0, {}};
+    FT_Face face = fontFace->face;
+
+    FT_Set_Transform(face, nullptr, &pen);
+    FT_Error error = FT_Load_Glyph(face, glyphIndex, FT_LOAD_DEFAULT);
+    if (error == 0) {
+        error = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
+    }
+    FT_Set_Transform(face, nullptr, nullptr);
+
+    if (error != 0) {
+        std::cerr << "Unable to render glyph " << glyphIndex << std::endl;
+        return glyph;
+    }
+
+    FT_GlyphSlot slot = face->glyph;
+    glyph.width = slot->bitmap.width;
+    glyph.rows = slot->bitmap.rows;
+    glyph.left = slot->bitmap_left;
+    glyph.top = slot->bitmap_top;
+    glyph.advance = slot->advance.x;
+    glyph.coverage.resize(glyph.width * glyph.rows);
+
+    for (int row = 0; row < glyph.rows; row++) {
+        const unsigned char* source = slot->bitmap.buffer + row * slot->bitmap.pitch;
+        std::copy(source, source + glyph.width, glyph.coverage.begin() + row * glyph.width);
+    }
+
+    return glyph;
+}
+
+FontManager& FontManager::getInstance() {
+    static FontManager instance;
+    return instance;
+}
+
+FontManager::FontManager() {
+    loadTime = std::chrono::duration<double, std::milli>::zero();
+
+    if (FT_Init_FreeType(&library) != 0) {
+        throw std::runtime_error("Unable to initialize FreeType.");
+    }
+}
+
+FontManager::~FontManager() {
+    fonts.clear();
+    faces.clear();
+    FT_Done_FreeType(library);
+}
+
+void FontManager::preloadConfiguredFonts() {
+    std::string fontPath = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_PATH);
+    int fontSize = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_SIZE);
+
+    getFont(fontPath, fontSize);
+    std::cout << "Fonts loaded in " << loadTime.count() << " ms" << std::endl;
+}
+
+std::shared_ptr<SizedFont> FontManager::getFont(const std::string& fontPath, int fontSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto key = std::make_pair(fontPath, fontSize);
+    auto found = fonts.find(key);
+    if (found != fonts.end()) {
+        return found->second;
+    }
+
+    std::shared_ptr<SizedFont> font = std::make_shared<SizedFont>(loadFace(fontPath), fontSize);
+    fonts[key] = font;
+    return font;
+}
+
+void FontManager::printStats() const {
+    std::cout << "Font manager: " << faces.size() << " faces, " << fonts.size() << " sizes, loaded in " << loadTime.count() << " ms" << std::endl;
+}
+
+std::shared_ptr<FontFace> FontManager::loadFace(const std::string& fontPath) {
+    auto found = faces.find(fontPath);
+    if (found != faces.end()) {
+        return found->second;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::shared_ptr<FontFace> fontFace = std::make_shared<FontFace>();
+    if (FT_New_Face(library, fontPath.c_str(), 0, &fontFace->face) != 0) {
+        throw std::runtime_error("Unable to load font: " + fontPath);
+    }
+
+    loadTime += std::chrono::steady_clock::now() - start;
+
+    faces[fontPath] = fontFace;
+    return fontFace;
+}
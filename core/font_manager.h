@@ -0,0 +1,79 @@
+#ifndef FONT_MANAGER_H
+#define FONT_MANAGER_H
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SIZES_H
+
+struct GlyphBitmap {
+    int width;
+    int rows;
+    int left;
+    int top;
+    FT_Pos advance;
+    std::vector<unsigned char> coverage;
+};
+
+// A FreeType face that stays open for the life of the process.
+// FreeType faces are not thread-safe, so every use goes through the face mutex.
+struct FontFace {
+    FT_Face face = nullptr;
+    std::mutex mutex;
+    ~FontFace();
+};
+
+// One size of a preloaded face. All methods lock the underlying face and may be called from any thread.
+class SizedFont {
+public:
+    SizedFont(const std::shared_ptr<FontFace>& fontFace, int fontSize);
+    ~SizedFont();
+    int getFontSize() const;
+    bool hasKerning() const;
+    FT_UInt getGlyphIndex(char32_t codepoint);
+    FT_Pos getAdvance(FT_UInt glyphIndex);
+    FT_Pos getKerning(FT_UInt previousGlyph, FT_UInt glyph);
+    GlyphBitmap renderGlyph(FT_UInt glyphIndex, FT_Vector pen);
+
+private:
+    SizedFont(const SizedFont&) = delete;
+    SizedFont& operator=(const SizedFont&) = delete;
+
+private:
+    std::shared_ptr<FontFace> fontFace;
+    FT_Size size;
+    int fontSize;
+    bool useKerning;
+
+};
+
+class FontManager {
+public:
+    static FontManager& getInstance();
+    void preloadConfiguredFonts();
+    std::shared_ptr<SizedFont> getFont(const std::string& fontPath, int fontSize);
+    void printStats() const;
+
+private:
+    FontManager();
+    ~FontManager();
+    FontManager(const FontManager&) = delete;
+    FontManager& operator=(const FontManager&) = delete;
+    std::shared_ptr<FontFace> loadFace(const std::string& fontPath);
+
+private:
+    FT_Library library;
+    std::mutex mutex;
+    std::map<std::string, std::shared_ptr<FontFace>> faces;
+    std::map<std::pair<std::string, int>, std::shared_ptr<SizedFont>> fonts;
+    std::chrono::duration<double, std::milli> loadTime;
+
+};
+
+#endif // FONT_MANAGER_H
@@ -0,0 +1,132 @@
+#include "glyph_advance_cache.h"
+#include <iostream>
+#include "../utils/string_utils.h"
+
+GlyphAdvanceCache& GlyphAdvanceCache::getInstance() {
+    static GlyphAdvanceCache instance;
+    return instance;
+}
+
+GlyphAdvanceCache::GlyphAdvanceCache() {
+    hits = 0;
+    misses = 0;
+
+    // The font manager has to outlive the fonts held here
+    FontManager::getInstance();
+}
+
+int GlyphAdvanceCache::getTextWidth(const std::string& fontPath, int fontSize, const std::string& text) {
+    const std::u32string codepoints = StringUtils::decodeUtf8(text);
+    FT_Pos penX = 0;
+
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto found = fonts.find(std::make_pair(fontPath, fontSize));
+        if (found != fonts.end() && measureCached(found->second, codepoints, penX)) {
+            return (int) (((double) penX) / 64.0);
+        }
+    }
+
+    // Something is missing, so measure again while filling in the cache
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    FontMetrics& metrics = getFontMetrics(fontPath, fontSize);
+
+    penX = 0;
+    FT_UInt previousGlyph = 0;
+    for (char32_t codepoint : codepoints) {
+        const GlyphAdvance& glyph = getGlyphAdvance(metrics, codepoint);
+
+        if (metrics.font->hasKerning() && previousGlyph && glyph.glyphIndex) {
+            penX += getKerning(metrics, previousGlyph, glyph.glyphIndex);
+        }
+
+        penX += glyph.advance;
+        previousGlyph = glyph.glyphIndex;
+    }
+
+    // Advances are in 26.6 fixed point
+    return (int) (((double) penX) / 64.0);
+}
+
+unsigned long GlyphAdvanceCache::getHits() const {
+    return hits;
+}
+
+unsigned long GlyphAdvanceCache::getMisses() const {
+    return misses;
+}
+
+void GlyphAdvanceCache::printStats() const {
+    std::cout << "Glyph advance cache: " << hits << " hits, " << misses << " misses" << std::endl;
+}
+
+// Measures only from cached entries, giving up at the first glyph or kerning pair that is not there yet
+bool GlyphAdvanceCache::measureCached(const FontMetrics& metrics, const std::u32string& codepoints, FT_Pos& penX) {
+    unsigned long lookups = 0;
+    FT_UInt previousGlyph = 0;
+    for (char32_t codepoint : codepoints) {
+        auto glyph = metrics.glyphs.find(codepoint);
+        if (glyph == metrics.glyphs.end()) {
+            return false;
+        }
+        lookups++;
+
+        if (metrics.font->hasKerning() && previousGlyph && glyph->second.glyphIndex) {
+            auto kerning = metrics.kerning.find(((uint64_t) previousGlyph << 32) | glyph->second.glyphIndex);
+            if (kerning == metrics.kerning.end()) {
+                return false;
+            }
+            lookups++;
+            penX += kerning->second;
+        }
+
+        penX += glyph->second.advance;
+        previousGlyph = glyph->second.glyphIndex;
+    }
+
+    hits += lookups;
+    return true;
+}
+
+GlyphAdvanceCache::FontMetrics& GlyphAdvanceCache::getFontMetrics(const std::string& fontPath, int fontSize) {
+    auto key = std::make_pair(fontPath, fontSize);
+    auto found = fonts.find(key);
+    if (found != fonts.end()) {
+        return found->second;
+    }
+
+    FontMetrics metrics;
+    metrics.font = FontManager::getInstance().getFont(fontPath, fontSize);
+
+    return fonts.emplace(key, std::move(metrics)).first->second;
+}
+
+const GlyphAdvanceCache::GlyphAdvance& GlyphAdvanceCache::getGlyphAdvance(FontMetrics& metrics, char32_t codepoint) {
+    auto found = metrics.glyphs.find(codepoint);
+    if (found != metrics.glyphs.end()) {
+        hits++;
+        return found->second;
+    }
+
+    misses++;
+    GlyphAdvance glyph;
+    glyph.glyphIndex = metrics.font->getGlyphIndex(codepoint);
+    glyph.advance = metrics.font->getAdvance(glyph.glyphIndex);
+
+    return metrics.glyphs.emplace(codepoint, glyph).first->second;
+}
+
+FT_Pos GlyphAdvanceCache::getKerning(FontMetrics& metrics, FT_UInt previousGlyph, FT_UInt glyph) {
+    uint64_t pair = ((uint64_t) previousGlyph << 32) | glyph;
+    auto found = metrics.kerning.find(pair);
+    if (found != metrics.kerning.end()) {
+        hits++;
+        return found->second;
+    }
+
+    misses++;
+    FT_Pos kerning = metrics.font->getKerning(previousGlyph, glyph);
+
+    metrics.kerning.emplace(pair, kerning);
+    return kerning;
+}
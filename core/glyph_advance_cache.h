@@ -0,0 +1,54 @@
+#ifndef GLYPH_ADVANCE_CACHE_H
+#define GLYPH_ADVANCE_CACHE_H
+
+#include <atomic>
+#include <string>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include "font_manager.h"
+
+// Process-wide cache of glyph advances and kerning pairs used to measure text.
+// Widths match pngwriter::get_text_width_utf8 for the same font path and size. All methods may be called from any thread;
+// text whose glyphs are all cached is measured under a shared lock, so render threads only queue behind a miss.
+class GlyphAdvanceCache {
+public:
+    static GlyphAdvanceCache& getInstance();
+    int getTextWidth(const std::string& fontPath, int fontSize, const std::string& text);
+    unsigned long getHits() const;
+    unsigned long getMisses() const;
+    void printStats() const;
+
+private:
+    struct GlyphAdvance {
+        FT_UInt glyphIndex;
+        FT_Pos advance;
+    };
+
+    struct FontMetrics {
+        std::shared_ptr<SizedFont> font;
+        std::unordered_map<char32_t, GlyphAdvance> glyphs;
+        std::unordered_map<uint64_t, FT_Pos> kerning;
+    };
+
+    GlyphAdvanceCache();
+    GlyphAdvanceCache(const GlyphAdvanceCache&) = delete;
+    GlyphAdvanceCache& operator=(const GlyphAdvanceCache&) = delete;
+
+    bool measureCached(const FontMetrics& metrics, const std::u32string& codepoints, FT_Pos& penX);
+    FontMetrics& getFontMetrics(const std::string& fontPath, int fontSize);
+    const GlyphAdvance& getGlyphAdvance(FontMetrics& metrics, char32_t codepoint);
+    FT_Pos getKerning(FontMetrics& metrics, FT_UInt previousGlyph, FT_UInt glyph);
+
+private:
+    mutable std::shared_mutex mutex;
+    std::map<std::pair<std::string, int>, FontMetrics> fonts;
+    std::atomic<unsigned long> hits;
+    std::atomic<unsigned long> misses;
+
+};
+
+#endif // GLYPH_ADVANCE_CACHE_H
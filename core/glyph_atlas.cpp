@@ -0,0 +1,66 @@
+#include "glyph_atlas.h"
+#include <iostream>
+#include <functional>
+
+// Sub-pixel positions are in 26.6 fixed point
+const FT_Pos PIXEL = 64;
+
+GlyphAtlas& GlyphAtlas::getInstance() {
+    static GlyphAtlas instance;
+    return instance;
+}
+
+GlyphAtlas::GlyphAtlas() {
+    hits = 0;
+    misses = 0;
+    bytes = 0;
+
+    // The font manager has to outlive the fonts referenced here
+    FontManager::getInstance();
+}
+
+// Returns the cached mask for the glyph at the given pen position.
+// offsetX and offsetY receive the whole-pixel part of the pen to add to the mask's left and top.
+const GlyphBitmap& GlyphAtlas::getGlyph(SizedFont& font, FT_UInt glyphIndex, FT_Vector pen, int& offsetX, int& offsetY) {
+    FT_Vector phase = {pen.x & (PIXEL - 1), pen.y & (PIXEL - 1)};
+    offsetX = (int) ((pen.x - phase.x) / PIXEL);
+    offsetY = (int) ((pen.y - phase.y) / PIXEL);
+
+    GlyphKey key = {&font, glyphIndex, (int) phase.x, (int) phase.y};
+
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto found = glyphs.find(key);
+        if (found != glyphs.end()) {
+            hits++;
+            return found->second;
+        }
+    }
+
+    misses++;
+    GlyphBitmap glyph = font.renderGlyph(glyphIndex, phase);
+
+    // Another thread may have rendered the same glyph meanwhile; either copy is identical.
+    // Rehashing keeps references to elements valid, so returned masks stay usable.
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto inserted = glyphs.emplace(key, std::move(glyph));
+    if (inserted.second) {
+        bytes += inserted.first->second.coverage.size();
+    }
+    return inserted.first->second;
+}
+
+void GlyphAtlas::printStats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::cout << "Glyph atlas: " << glyphs.size() << " glyphs (" << bytes << " bytes), " << hits << " hits, " << misses << " misses" << std::endl;
+}
+
+bool GlyphAtlas::GlyphKey::operator==(const GlyphKey& other) const {
+    return font == other.font && glyphIndex == other.glyphIndex && phaseX == other.phaseX && phaseY == other.phaseY;
+}
+
+size_t GlyphAtlas::GlyphKeyHash::operator()(const GlyphKey& key) const {
+    size_t hash = std::hash<const SizedFont*>()(key.font);
+    hash ^= std::hash<uint64_t>()(((uint64_t) key.glyphIndex << 16) | (key.phaseX << 8) | key.phaseY) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
@@ -0,0 +1,45 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstdint>
+#include "font_manager.h"
+
+// Process-wide store of rasterized glyph coverage masks keyed by font, size and glyph id.
+// Masks are rendered at the pen's sub-pixel phase so blitting them is identical to rasterizing in place.
+// Lookups share the lock and a miss is rasterized outside it, so render threads never wait on FreeType here.
+class GlyphAtlas {
+public:
+    static GlyphAtlas& getInstance();
+    const GlyphBitmap& getGlyph(SizedFont& font, FT_UInt glyphIndex, FT_Vector pen, int& offsetX, int& offsetY);
+    void printStats() const;
+
+private:
+    struct GlyphKey {
+        const SizedFont* font;
+        FT_UInt glyphIndex;
+        int phaseX;
+        int phaseY;
+        bool operator==(const GlyphKey& other) const;
+    };
+
+    struct GlyphKeyHash {
+        size_t operator()(const GlyphKey& key) const;
+    };
+
+    GlyphAtlas();
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<GlyphKey, GlyphBitmap, GlyphKeyHash> glyphs;
+    std::atomic<unsigned long> hits;
+    std::atomic<unsigned long> misses;
+    size_t bytes;
+
+};
+
+#endif // GLYPH_ATLAS_H
@@ -0,0 +1,112 @@
+#include "parallel_deflate.h"
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+const size_t WINDOW_SIZE = 32 * 1024;
+const int WINDOW_BITS = 15;
+const int MEMORY_LEVEL = 8;
+
+namespace {
+
+    struct CompressedChunk {
+        std::string data;
+        uLong adler;
+        size_t size;
+    };
+
+    CompressedChunk deflateChunk(const uint8_t* data, size_t begin, size_t end, bool isLast, int level, int strategy) {
+        z_stream stream = {};
+        // Negative window bits give raw deflate data without a zlib header or trailer
+        if (deflateInit2(&stream, level, Z_DEFLATED, -WINDOW_BITS, MEMORY_LEVEL, strategy) != Z_OK) {
+            throw std::runtime_error("Unable to initialize deflate.");
+        }
+
+        if (begin > 0) {
+            size_t dictionaryStart = begin > WINDOW_SIZE ? begin - WINDOW_SIZE : 0;
+            deflateSetDictionary(&stream, data + dictionaryStart, begin - dictionaryStart);
+        }
+
+        CompressedChunk chunk;
+        chunk.size = end - begin;
+        chunk.adler = adler32(adler32(0, Z_NULL, 0), data + begin, chunk.size);
+        chunk.data.resize(deflateBound(&stream, chunk.size) + 16);
+
+        stream.next_in = const_cast<Bytef*>(data + begin);
+        stream.avail_in = chunk.size;
+        stream.next_out = reinterpret_cast<Bytef*>(&chunk.data[0]);
+        stream.avail_out = chunk.data.size();
+
+        // A sync flush ends the chunk on a byte boundary with no final block
+        int result = deflate(&stream, isLast ? Z_FINISH : Z_SYNC_FLUSH);
+        bool isComplete = isLast ? result == Z_STREAM_END : (result == Z_OK && stream.avail_in == 0);
+        chunk.data.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        if (!isComplete) {
+            throw std::runtime_error("Unable to deflate image data.");
+        }
+
+        return chunk;
+    }
+
+    // Same header zlib writes for these settings
+    void appendZlibHeader(std::string& output, int level, int strategy) {
+        if (level == Z_DEFAULT_COMPRESSION) {
+            level = 6;
+        }
+
+        int levelFlags = 2;
+        if (strategy >= Z_HUFFMAN_ONLY || level < 2) {
+            levelFlags = 0;
+        } else if (level < 6) {
+            levelFlags = 1;
+        } else if (level > 6) {
+            levelFlags = 3;
+        }
+
+        unsigned int header = (((Z_DEFLATED + ((WINDOW_BITS - 8) << 4)) << 8) | (levelFlags << 6));
+        header += 31 - (header % 31);
+        output.push_back((char) (header >> 8));
+        output.push_back((char) (header & 0xFF));
+    }
+
+}
+
+std::string ParallelDeflate::compress(const uint8_t* data, size_t size, int level, int strategy, ThreadPool& pool, size_t chunkSize) {
+    chunkSize = std::max(chunkSize, WINDOW_SIZE);
+    size_t chunkCount = std::max<size_t>(1, (size + chunkSize - 1) / chunkSize);
+
+    std::vector<std::future<CompressedChunk>> chunks;
+    for (size_t i = 0; i < chunkCount; i++) {
+        size_t begin = i * chunkSize;
+        size_t end = std::min(size, begin + chunkSize);
+        bool isLast = (i == chunkCount - 1);
+        chunks.push_back(pool.submit([=]() {
+            return deflateChunk(data, begin, end, isLast, level, strategy);
+        }));
+    }
+
+    // Every chunk reads from data, so none may still be running if one of them failed
+    for (std::future<CompressedChunk>& future : chunks) {
+        future.wait();
+    }
+
+    std::string output;
+    appendZlibHeader(output, level, strategy);
+
+    uLong adler = adler32(0, Z_NULL, 0);
+    for (std::future<CompressedChunk>& future : chunks) {
+        CompressedChunk chunk = future.get();
+        output += chunk.data;
+        adler = adler32_combine(adler, chunk.adler, chunk.size);
+    }
+
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        output.push_back((char) ((adler >> shift) & 0xFF));
+    }
+
+    return output;
+}
@@ -0,0 +1,20 @@
+#ifndef PARALLEL_DEFLATE_H
+#define PARALLEL_DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../utils/thread_pool.h"
+
+namespace ParallelDeflate {
+
+    const size_t DEFAULT_CHUNK_SIZE = 128 * 1024;
+
+    // Compresses data into a single zlib stream by deflating chunks of about chunkSize bytes
+    // on the pool. Every chunk is primed with the 32KB before it and ends on a sync flush
+    // so the pieces can be concatenated, and the chunk checksums are combined at the end.
+    std::string compress(const uint8_t* data, size_t size, int level, int strategy, ThreadPool& pool, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+}
+
+#endif // PARALLEL_DEFLATE_H
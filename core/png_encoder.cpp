@@ -0,0 +1,449 @@
+#include "png_encoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <png.h>
+#include <zlib.h>
+#include "composite_kernels.h"
+#include "parallel_deflate.h"
+#include "../utils/thread_pool.h"
+
+const int RGB16_BIT_DEPTH = 16;
+const int BIT_DEPTH = 8;
+const int CHANNELS = 3;
+const int RAMP_SIZE = 256;
+const Color OUTLINE_COLOR = {1.0, 0.0, 0.0};
+const size_t PARALLEL_DEFLATE_MIN_SIZE = 2 * ParallelDeflate::DEFAULT_CHUNK_SIZE;
+const size_t IDAT_CHUNK_SIZE = 1024 * 1024;
+
+namespace {
+
+    uint16_t toSample(float value) {
+        return (uint16_t) (65535 * value);
+    }
+
+    void writeSample(png_bytep destination, uint16_t sample) {
+        destination[0] = sample >> 8;
+        destination[1] = sample & 0xFF;
+    }
+
+    void writePixel(png_bytep row, int x, const uint16_t* rgb) {
+        png_bytep pixel = row + (size_t) x * CHANNELS * 2;
+        for (int channel = 0; channel < CHANNELS; channel++) {
+            writeSample(pixel + channel * 2, rgb[channel]);
+        }
+    }
+
+    // Every coverage value maps to exactly one colour between the background and the font colour
+    CompositeKernels::ColorRamp buildColorRamp(const Color& fontColor, const Color& backgroundColor) {
+        CompositeKernels::ColorRamp ramp;
+        for (int coverage = 0; coverage < 256; coverage++) {
+            float alpha = coverage / 255.0f;
+            const uint16_t rgb[CHANNELS] = {
+                toSample(alpha * fontColor.red + (1 - alpha) * backgroundColor.red),
+                toSample(alpha * fontColor.green + (1 - alpha) * backgroundColor.green),
+                toSample(alpha * fontColor.blue + (1 - alpha) * backgroundColor.blue)
+            };
+            writePixel(ramp.pixels[coverage], 0, rgb);
+        }
+        return ramp;
+    }
+
+    uint8_t toByte(float value) {
+        return (uint8_t) std::lround(255 * value);
+    }
+
+    float mix(float font, float background, float alpha) {
+        return alpha * font + (1 - alpha) * background;
+    }
+
+    bool isGray(const Color& color) {
+        return color.red == color.green && color.green == color.blue;
+    }
+
+    PngEncoder::ColorMode resolveColorMode(const CoverageCanvas& canvas, const PngEncoder::Options& options, const Color& fontColor, const Color& backgroundColor) {
+        // Outlines are drawn in a colour that is not on the ramp
+        if (!canvas.getOutlines().empty()) {
+            return PngEncoder::ColorMode::RGB16;
+        }
+
+        if (options.colorMode == PngEncoder::ColorMode::GRAYSCALE && !(isGray(fontColor) && isGray(backgroundColor))) {
+            return PngEncoder::ColorMode::PALETTE;
+        }
+
+        return options.colorMode;
+    }
+
+    int toPngFilter(PngEncoder::Filter filter) {
+        switch (filter) {
+            case PngEncoder::Filter::NONE:
+                return PNG_FILTER_NONE;
+            case PngEncoder::Filter::SUB:
+                return PNG_FILTER_SUB;
+            case PngEncoder::Filter::UP:
+                return PNG_FILTER_UP;
+            case PngEncoder::Filter::AVERAGE:
+                return PNG_FILTER_AVG;
+            case PngEncoder::Filter::PAETH:
+                return PNG_FILTER_PAETH;
+            default:
+                return PNG_ALL_FILTERS;
+        }
+    }
+
+    int toZlibStrategy(PngEncoder::Strategy strategy) {
+        switch (strategy) {
+            case PngEncoder::Strategy::FILTERED:
+                return Z_FILTERED;
+            case PngEncoder::Strategy::HUFFMAN_ONLY:
+                return Z_HUFFMAN_ONLY;
+            case PngEncoder::Strategy::RLE:
+                return Z_RLE;
+            default:
+                return Z_DEFAULT_STRATEGY;
+        }
+    }
+
+    int paethPredictor(int left, int up, int upLeft) {
+        int estimate = left + up - upLeft;
+        int distanceLeft = std::abs(estimate - left);
+        int distanceUp = std::abs(estimate - up);
+        int distanceUpLeft = std::abs(estimate - upLeft);
+        if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft) {
+            return left;
+        }
+        return distanceUp <= distanceUpLeft ? up : upLeft;
+    }
+
+    // Writes the filter type byte followed by the filtered row, as it is stored in the image data
+    void filterRow(int type, const png_byte* row, const png_byte* previous, size_t rowBytes, int bytesPerPixel, png_bytep output) {
+        output[0] = type;
+        png_bytep filtered = output + 1;
+        size_t leading = std::min<size_t>(bytesPerPixel, rowBytes);
+
+        // The first pixel has no left neighbour, which the filters treat as zero
+        switch (type) {
+            case PNG_FILTER_VALUE_SUB:
+                std::copy(row, row + leading, filtered);
+                for (size_t i = leading; i < rowBytes; i++) {
+                    filtered[i] = row[i] - row[i - bytesPerPixel];
+                }
+                break;
+            case PNG_FILTER_VALUE_UP:
+                for (size_t i = 0; i < rowBytes; i++) {
+                    filtered[i] = row[i] - previous[i];
+                }
+                break;
+            case PNG_FILTER_VALUE_AVG:
+                for (size_t i = 0; i < leading; i++) {
+                    filtered[i] = row[i] - (previous[i] >> 1);
+                }
+                for (size_t i = leading; i < rowBytes; i++) {
+                    filtered[i] = row[i] - ((row[i - bytesPerPixel] + previous[i]) >> 1);
+                }
+                break;
+            case PNG_FILTER_VALUE_PAETH:
+                for (size_t i = 0; i < leading; i++) {
+                    filtered[i] = row[i] - previous[i];
+                }
+                for (size_t i = leading; i < rowBytes; i++) {
+                    filtered[i] = row[i] - paethPredictor(row[i - bytesPerPixel], previous[i], previous[i - bytesPerPixel]);
+                }
+                break;
+            default:
+                std::copy(row, row + rowBytes, filtered);
+                break;
+        }
+    }
+
+    unsigned long sumOfMagnitudes(const png_byte* filtered, size_t rowBytes) {
+        unsigned long sum = 0;
+        for (size_t i = 0; i < rowBytes; i++) {
+            sum += filtered[i] < 128 ? filtered[i] : 256 - filtered[i];
+        }
+        return sum;
+    }
+
+    // Same heuristic libpng uses: the filter whose output bytes are closest to zero
+    void filterRowAdaptive(const png_byte* row, const png_byte* previous, size_t rowBytes, int bytesPerPixel, png_bytep output, png_bytep scratch) {
+        filterRow(PNG_FILTER_VALUE_NONE, row, previous, rowBytes, bytesPerPixel, output);
+        unsigned long bestSum = sumOfMagnitudes(output + 1, rowBytes);
+
+        for (int type = PNG_FILTER_VALUE_SUB; type <= PNG_FILTER_VALUE_PAETH && bestSum > 0; type++) {
+            filterRow(type, row, previous, rowBytes, bytesPerPixel, scratch);
+            unsigned long sum = sumOfMagnitudes(scratch + 1, rowBytes);
+            if (sum < bestSum) {
+                bestSum = sum;
+                std::copy(scratch, scratch + rowBytes + 1, output);
+            }
+        }
+    }
+
+    int toFilterValue(PngEncoder::Filter filter) {
+        switch (filter) {
+            case PngEncoder::Filter::SUB:
+                return PNG_FILTER_VALUE_SUB;
+            case PngEncoder::Filter::UP:
+                return PNG_FILTER_VALUE_UP;
+            case PngEncoder::Filter::AVERAGE:
+                return PNG_FILTER_VALUE_AVG;
+            case PngEncoder::Filter::PAETH:
+                return PNG_FILTER_VALUE_PAETH;
+            default:
+                return PNG_FILTER_VALUE_NONE;
+        }
+    }
+
+    ThreadPool& getDeflatePool() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // Filters bands of rows in parallel into one buffer, then deflates it in parallel chunks
+    std::string compressImageData(int height, size_t rowBytes, int bytesPerPixel, const PngEncoder::Options& options,
+                                  const std::function<const png_byte*(int, png_bytep)>& getRawRow) {
+        ThreadPool& pool = getDeflatePool();
+        const size_t stride = rowBytes + 1;
+        const int rowsPerBand = std::max<size_t>(1, ParallelDeflate::DEFAULT_CHUNK_SIZE / stride);
+        std::vector<png_byte> filtered(stride * height);
+
+        std::vector<std::future<void>> bands;
+        for (int start = 0; start < height; start += rowsPerBand) {
+            int end = std::min(height, start + rowsPerBand);
+            bands.push_back(pool.submit([&, start, end]() {
+                std::vector<png_byte> previousScratch(rowBytes, 0);
+                std::vector<png_byte> currentScratch(rowBytes);
+                std::vector<png_byte> filterScratch(stride);
+
+                const png_byte* previous = previousScratch.data();
+                if (start > 0) {
+                    previous = getRawRow(start - 1, previousScratch.data());
+                }
+
+                for (int y = start; y < end; y++) {
+                    const png_byte* row = getRawRow(y, currentScratch.data());
+                    png_bytep output = &filtered[stride * y];
+                    if (options.filter == PngEncoder::Filter::ADAPTIVE) {
+                        filterRowAdaptive(row, previous, rowBytes, bytesPerPixel, output, filterScratch.data());
+                    } else {
+                        filterRow(toFilterValue(options.filter), row, previous, rowBytes, bytesPerPixel, output);
+                    }
+
+                    // The row may live in currentScratch, which the next row overwrites
+                    if (row == currentScratch.data()) {
+                        std::swap(previousScratch, currentScratch);
+                        previous = previousScratch.data();
+                    } else {
+                        previous = row;
+                    }
+                }
+            }));
+        }
+
+        for (std::future<void>& band : bands) {
+            band.wait();
+        }
+        for (std::future<void>& band : bands) {
+            band.get();
+        }
+
+        int level = options.compressionLevel == -1 ? Z_DEFAULT_COMPRESSION : options.compressionLevel;
+        return ParallelDeflate::compress(filtered.data(), filtered.size(), level, toZlibStrategy(options.strategy), pool);
+    }
+
+    void appendToString(png_structp png, png_bytep data, png_size_t length) {
+        std::string* imageData = static_cast<std::string*>(png_get_io_ptr(png));
+        imageData->append(reinterpret_cast<const char*>(data), length);
+    }
+
+    // libpng reports errors by longjmp-ing back to the setjmp here. Keeping it in its own frame means
+    // none of the caller's locals are live across setjmp, so none can be clobbered.
+    template <typename Write>
+    bool writeWithPngErrors(png_structp png, Write& write) {
+        if (setjmp(png_jmpbuf(png))) {
+            return false;
+        }
+        write();
+        return true;
+    }
+
+    void colorizeRow(const CoverageCanvas& canvas, int rowFromTop, const CompositeKernels::ColorRamp& ramp, png_bytep row) {
+        CompositeKernels::colorizeRow(row, canvas.getRow(rowFromTop), canvas.getWidth(), ramp);
+
+        const uint16_t outline[CHANNELS] = {toSample(OUTLINE_COLOR.red), toSample(OUTLINE_COLOR.green), toSample(OUTLINE_COLOR.blue)};
+        int y = canvas.getHeight() - rowFromTop;
+        for (const CoverageCanvas::Outline& box : canvas.getOutlines()) {
+            if (y < box.startY || y > box.endY) {
+                continue;
+            }
+
+            for (int x = box.startX; x <= box.endX; x++) {
+                bool isEdge = (y == box.startY || y == box.endY || x == box.startX || x == box.endX);
+                if (isEdge && x >= 1 && x <= canvas.getWidth()) {
+                    writePixel(row, x - 1, outline);
+                }
+            }
+        }
+    }
+
+}
+
+PngEncoder::Options PngEncoder::parseOptions(const std::string& colorMode, int compressionLevel, const std::string& filter, const std::string& strategy, bool parallelDeflate) {
+    const std::map<std::string, ColorMode> COLOR_MODES = {
+        {"rgb16", ColorMode::RGB16},
+        {"palette", ColorMode::PALETTE},
+        {"grayscale", ColorMode::GRAYSCALE}
+    };
+    const std::map<std::string, Filter> FILTERS = {
+        {"none", Filter::NONE},
+        {"sub", Filter::SUB},
+        {"up", Filter::UP},
+        {"average", Filter::AVERAGE},
+        {"paeth", Filter::PAETH},
+        {"adaptive", Filter::ADAPTIVE}
+    };
+    const std::map<std::string, Strategy> STRATEGIES = {
+        {"default", Strategy::DEFAULT},
+        {"filtered", Strategy::FILTERED},
+        {"huffman_only", Strategy::HUFFMAN_ONLY},
+        {"rle", Strategy::RLE}
+    };
+
+    if (!COLOR_MODES.count(colorMode)) {
+        throw std::runtime_error("Invalid PNG color mode: " + colorMode);
+    }
+    if (!FILTERS.count(filter)) {
+        throw std::runtime_error("Invalid PNG filter: " + filter);
+    }
+    if (!STRATEGIES.count(strategy)) {
+        throw std::runtime_error("Invalid PNG compression strategy: " + strategy);
+    }
+    if (compressionLevel < -1 || compressionLevel > 9) {
+        throw std::runtime_error("Invalid PNG compression level: " + std::to_string(compressionLevel));
+    }
+
+    Options options;
+    options.colorMode = COLOR_MODES.at(colorMode);
+    options.compressionLevel = compressionLevel;
+    options.filter = FILTERS.at(filter);
+    options.strategy = STRATEGIES.at(strategy);
+    options.parallelDeflate = parallelDeflate;
+    return options;
+}
+
+std::string PngEncoder::encode(const CoverageCanvas& canvas, const Color& fontColor, const Color& backgroundColor, const Options& options, const std::string& exifData) {
+    std::string imageData;
+    ColorMode colorMode = resolveColorMode(canvas, options, fontColor, backgroundColor);
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!png || !info) {
+        png_destroy_write_struct(&png, nullptr);
+        throw std::runtime_error("Unable to initialize libpng.");
+    }
+
+    std::vector<png_byte> row;
+    CompositeKernels::ColorRamp ramp;
+    std::vector<png_color> palette(RAMP_SIZE);
+    std::vector<png_byte> grayRamp(RAMP_SIZE);
+    size_t rowBytes = canvas.getWidth();
+    int bytesPerPixel = 1;
+
+    if (colorMode == ColorMode::RGB16) {
+        bytesPerPixel = CHANNELS * 2;
+        rowBytes *= bytesPerPixel;
+        ramp = buildColorRamp(fontColor, backgroundColor);
+    }
+    row.resize(rowBytes);
+
+    for (int coverage = 0; coverage < RAMP_SIZE; coverage++) {
+        float alpha = coverage / 255.0f;
+        palette[coverage].red = toByte(mix(fontColor.red, backgroundColor.red, alpha));
+        palette[coverage].green = toByte(mix(fontColor.green, backgroundColor.green, alpha));
+        palette[coverage].blue = toByte(mix(fontColor.blue, backgroundColor.blue, alpha));
+        grayRamp[coverage] = palette[coverage].red;
+    }
+
+    // Scratch is only written to when the row is not already in the canvas
+    auto getRawRow = [&](int y, png_bytep scratch) -> const png_byte* {
+        if (colorMode == ColorMode::RGB16) {
+            colorizeRow(canvas, y, ramp, scratch);
+            return scratch;
+        } else if (colorMode == ColorMode::PALETTE) {
+            // Coverage values are the palette indexes
+            return canvas.getRow(y);
+        }
+
+        const uint8_t* coverage = canvas.getRow(y);
+        for (int x = 0; x < canvas.getWidth(); x++) {
+            scratch[x] = grayRamp[coverage[x]];
+        }
+        return scratch;
+    };
+
+    // Small images, and any image on a single core, are faster to compress on this thread than to split up
+    std::string compressedData;
+    const bool isParallel = options.parallelDeflate && std::thread::hardware_concurrency() > 1
+        && (rowBytes + 1) * canvas.getHeight() >= PARALLEL_DEFLATE_MIN_SIZE;
+    if (isParallel) {
+        try {
+            compressedData = compressImageData(canvas.getHeight(), rowBytes, bytesPerPixel, options, getRawRow);
+        } catch (...) {
+            png_destroy_write_struct(&png, &info);
+            throw;
+        }
+    }
+
+    auto write = [&]() {
+        png_set_write_fn(png, &imageData, appendToString, nullptr);
+        png_set_compression_level(png, options.compressionLevel == -1 ? Z_DEFAULT_COMPRESSION : options.compressionLevel);
+        png_set_compression_strategy(png, toZlibStrategy(options.strategy));
+        png_set_filter(png, PNG_FILTER_TYPE_BASE, toPngFilter(options.filter));
+
+        if (colorMode == ColorMode::RGB16) {
+            png_set_IHDR(png, info, canvas.getWidth(), canvas.getHeight(), RGB16_BIT_DEPTH, PNG_COLOR_TYPE_RGB,
+                PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        } else if (colorMode == ColorMode::PALETTE) {
+            png_set_IHDR(png, info, canvas.getWidth(), canvas.getHeight(), BIT_DEPTH, PNG_COLOR_TYPE_PALETTE,
+                PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+            png_set_PLTE(png, info, palette.data(), RAMP_SIZE);
+        } else {
+            png_set_IHDR(png, info, canvas.getWidth(), canvas.getHeight(), BIT_DEPTH, PNG_COLOR_TYPE_GRAY,
+                PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        }
+
+        if (!exifData.empty()) {
+            png_set_eXIf_1(png, info, exifData.size(), (png_bytep) exifData.data());
+        }
+        png_write_info(png, info);
+
+        if (isParallel) {
+            for (size_t offset = 0; offset < compressedData.size(); offset += IDAT_CHUNK_SIZE) {
+                size_t length = std::min(IDAT_CHUNK_SIZE, compressedData.size() - offset);
+                png_write_chunk(png, (png_const_bytep) "IDAT", (png_const_bytep) compressedData.data() + offset, length);
+            }
+            png_write_chunk(png, (png_const_bytep) "IEND", nullptr, 0);
+        } else {
+            for (int y = 0; y < canvas.getHeight(); y++) {
+                png_write_row(png, getRawRow(y, row.data()));
+            }
+
+            // Chunks in info were all written before the image data
+            png_write_end(png, nullptr);
+        }
+    };
+
+    if (!writeWithPngErrors(png, write)) {
+        png_destroy_write_struct(&png, &info);
+        throw std::runtime_error("Unable to encode image.");
+    }
+    png_destroy_write_struct(&png, &info);
+
+    return imageData;
+}
@@ -0,0 +1,51 @@
+#ifndef PNG_ENCODER_H
+#define PNG_ENCODER_H
+
+#include <string>
+#include "coverage_canvas.h"
+
+namespace PngEncoder {
+
+    // PALETTE stores the coverage as palette indexes into a 256 step colour ramp.
+    // GRAYSCALE only applies when both colours are grey and falls back to PALETTE otherwise.
+    // Images with debug outlines are always written as RGB16.
+    enum class ColorMode {
+        RGB16,
+        PALETTE,
+        GRAYSCALE
+    };
+
+    enum class Filter {
+        NONE,
+        SUB,
+        UP,
+        AVERAGE,
+        PAETH,
+        ADAPTIVE
+    };
+
+    enum class Strategy {
+        DEFAULT,
+        FILTERED,
+        HUFFMAN_ONLY,
+        RLE
+    };
+
+    struct Options {
+        ColorMode colorMode = ColorMode::RGB16;
+        int compressionLevel = -1;
+        Filter filter = Filter::ADAPTIVE;
+        Strategy strategy = Strategy::DEFAULT;
+        // Large images are filtered and deflated in chunks on a thread pool
+        bool parallelDeflate = false;
+    };
+
+    Options parseOptions(const std::string& colorMode, int compressionLevel, const std::string& filter, const std::string& strategy, bool parallelDeflate);
+
+    // Colours are applied to the coverage only here, while the image is encoded.
+    // Non-empty exifData is written as an eXIf chunk in the same pass.
+    std::string encode(const CoverageCanvas& canvas, const Color& fontColor, const Color& backgroundColor, const Options& options, const std::string& exifData = "");
+
+}
+
+#endif // PNG_ENCODER_H
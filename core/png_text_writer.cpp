@@ -1,7 +1,16 @@
 #include "png_text_writer.h"
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
+#include <sstream>
+#include "glyph_advance_cache.h"
+#include "font_manager.h"
+#include "glyph_atlas.h"
+#include "png_encoder.h"
+#include "render_cache.h"
 #include "../utils/string_utils.h"
+#include "../utils/file_utils.h"
 #include "../config/config_handler.h"
 
 namespace ConfigConst = ConfigConstants;
@@ -10,21 +19,63 @@ const std::string LEFT = "left";
 const std::string CENTER = "center";
 const std::string RIGHT = "right";
 const std::string DESCENDERS = "gjpqy";
+// Bump when a rendering change should invalidate previously cached images
+const int RENDER_VERSION = 1;
 
-PngTextWriter::PngTextWriter(const std::vector<std::string>& paragraphs, const std::string& filename) {
+namespace {
+
+    double elapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+}
+
+RenderOptions RenderOptions::fromConfig() {
+    RenderOptions options;
+    ConfigHandler& config = ConfigHandler::getInstance();
+
+    options.fontPath = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_PATH).get<std::string>();
+    options.fontSize = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_SIZE);
+    options.fontColor.red = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_COLOR, ConfigConst::RED);
+    options.fontColor.green = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_COLOR, ConfigConst::GREEN);
+    options.fontColor.blue = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_COLOR, ConfigConst::BLUE);
+    options.textAlignment = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::TEXT_ALIGNMENT).get<std::string>();
+    options.aspectRatioWidth = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::ASPECT_RATIO_WIDTH);
+    options.aspectRatioHeight = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::ASPECT_RATIO_HEIGHT);
+    options.margins = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::MARGINS);
+    options.alwaysUseDescenderSpacing = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::ALWAYS_USE_DESCENDER_SPACING);
+
+    options.pngOptions = PngEncoder::parseOptions(
+        config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PNG_OUTPUT, ConfigConst::COLOR_MODE).get<std::string>(),
+        config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PNG_OUTPUT, ConfigConst::COMPRESSION_LEVEL).get<int>(),
+        config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PNG_OUTPUT, ConfigConst::FILTER).get<std::string>(),
+        config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PNG_OUTPUT, ConfigConst::STRATEGY).get<std::string>(),
+        config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PNG_OUTPUT, ConfigConst::PARALLEL_DEFLATE).get<bool>());
+
+    options.paginate = config.getConfigValue(ConfigConst::SETTINGS, ConfigConst::PAGINATE_LONG_ENTRIES);
+    options.showLineBorders = config.getConfigValue(ConfigConst::DEBUG_SETTINGS, ConfigConst::SHOW_LINE_BORDERS);
+    options.useRenderCache = true;
+
+    return options;
+}
+
+PngTextWriter::PngTextWriter(const std::vector<std::string>& paragraphs, const std::string& filename)
+    : PngTextWriter(paragraphs, filename, RenderOptions::fromConfig()) {}
+
+PngTextWriter::PngTextWriter(const std::vector<std::string>& paragraphs, const std::string& filename, const RenderOptions& options) {
     // PngTextWriter parameters
     this->paragraphs = paragraphs;
     this->filename = filename;
 
     // Image dimensions
-    aspectRatioWidth = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::ASPECT_RATIO_WIDTH);
-    aspectRatioHeight = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::ASPECT_RATIO_HEIGHT);
+    aspectRatioWidth = options.aspectRatioWidth;
+    aspectRatioHeight = options.aspectRatioHeight;
     aspectRatio = (float) aspectRatioWidth / aspectRatioHeight;
     height = 1000; // Initial height
     width = round(height * aspectRatio); // Initial width
 
     // Image margins
-    margins = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::MARGINS);
+    margins = options.margins;
     leftMargin = round(width * margins);
     rightMargin = round(width * (1.0 - margins));
     bottomMargin = round(height * margins);
@@ -33,41 +84,102 @@ PngTextWriter::PngTextWriter(const std::vector<std::string>& paragraphs, const s
     textAreaHeight = topMargin - bottomMargin;
 
     // Image Font Settings
-    std::string fontPath = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_PATH);
-    font = new char[fontPath.length() + 1];
-    strcpy(font, fontPath.c_str());
-    fontSize = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_SIZE);
-    red = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_COLOR, ConfigConst::RED);
-    green = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_COLOR, ConfigConst::GREEN);
-    blue = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::FONT_COLOR, ConfigConst::BLUE);
-    textAlignment = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::TEXT_ALIGNMENT);
+    fontPath = options.fontPath;
+    fontSize = options.fontSize;
+    font = FontManager::getInstance().getFont(fontPath, fontSize);
+    markerFont = FontManager::getInstance().getFont(fontPath, std::max(1, fontSize / 2));
+    fontColor = options.fontColor;
+    backgroundColor = {0.0, 0.0, 0.0};
+    textAlignment = options.textAlignment;
+
+    // PNG Output Settings
+    pngOptions = options.pngOptions;
 
     // Spacing Settings
-    alwaysUseDescenderSpacing = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::ALWAYS_USE_DESCENDER_SPACING);
+    alwaysUseDescenderSpacing = options.alwaysUseDescenderSpacing;
     descenderSpacing = 30;
     lineSpacing = 10;
     paragraphSpacing = fontSize + descenderSpacing + lineSpacing;
-    spaceWidth = image.get_text_width_utf8(font, fontSize, " ");
+    spaceWidth = getTextWidth(" ");
 
     // Tracking Variables
     textHeight = 0;
     paragraphCount = paragraphs.size();
     heightDelta = 100;
 
+    // Pagination
+    paginate = options.paginate;
+    useRenderCache = options.useRenderCache;
+
     // Debugging
-    showLineBorders = ConfigHandler::getInstance().getConfigValue(ConfigConst::DEBUG_SETTINGS, ConfigConst::SHOW_LINE_BORDERS);
+    showLineBorders = options.showLineBorders;
 }
 
-PngTextWriter::~PngTextWriter() {
-    delete[] font;
+void PngTextWriter::writeText() {
+    FileUtils::writeFile(filename, renderImage());
 }
 
-void PngTextWriter::writeText() {
-    float backgroundColor = 0.0;
-    
-    image = pngwriter(width, height, backgroundColor, filename.c_str());
-    std::vector<std::vector<std::string>> textSegments = fitImage();
-    int cursor = topMargin - round((textAreaHeight - textHeight) / 2) - fontSize;
+std::string PngTextWriter::renderImage(const std::string& exifData) {
+    return loadOrRender(getCacheKey(exifData), [this, &exifData]() {
+        std::vector<std::vector<std::string>> textSegments = fitImage();
+        return drawPage(textSegments, round((textAreaHeight - textHeight) / 2), "", exifData);
+    });
+}
+
+// Keeps the base image size and flows the text over as many pages as it needs, each with a page marker.
+// Text that fits on one page, or has a word too wide for it, is rendered as a single image instead.
+std::vector<std::string> PngTextWriter::renderPages(const std::string& exifData) {
+    if (!paginate) {
+        return {renderImage(exifData)};
+    }
+
+    TextLayout layout = createLayout();
+    if (!layout.fitsWidth(textAreaWidth) || layout.getTextHeight(textAreaWidth) <= textAreaHeight) {
+        return {renderImage(exifData)};
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int markerHeight = markerFont->getFontSize() + descenderSpacing + lineSpacing;
+    std::vector<TextLayout::Page> pages = layout.paginate({textAreaWidth, textAreaHeight - markerHeight});
+    timings.layoutMs += elapsedMs(start);
+
+    std::vector<std::string> images;
+    for (size_t i = 0; i < pages.size(); i++) {
+        std::string pageNumber = "(" + std::to_string(i + 1) + "/" + std::to_string(pages.size()) + ")";
+        std::string marker = (i + 1 < pages.size()) ? "continued " + pageNumber : pageNumber;
+        std::string cacheKey = getCacheKey(exifData) + "page:" + std::to_string(i) + "/" + std::to_string(pages.size()) + ";";
+
+        images.push_back(loadOrRender(cacheKey, [&]() {
+            textHeight = pages.at(i).textHeight;
+            return drawPage(pages.at(i).lines, 0, marker, exifData);
+        }));
+    }
+
+    return images;
+}
+
+// Returns the cached image for the key when there is one, otherwise renders and caches it
+std::string PngTextWriter::loadOrRender(const std::string& cacheKeyData, const std::function<std::string()>& render) {
+    if (!useRenderCache || !RenderCache::getInstance().isEnabled()) {
+        return render();
+    }
+
+    std::string imageData;
+    std::string cacheKey = RenderCache::hashKey(cacheKeyData);
+    if (RenderCache::getInstance().load(cacheKey, imageData)) {
+        return imageData;
+    }
+
+    imageData = render();
+    RenderCache::getInstance().store(cacheKey, imageData);
+    return imageData;
+}
+
+// Draws the lines from the top margin down, starting topOffset pixels below it, and encodes the image
+std::string PngTextWriter::drawPage(const std::vector<std::vector<std::string>>& textSegments, int topOffset, const std::string& marker, const std::string& exifData) {
+    auto start = std::chrono::steady_clock::now();
+    canvas.resize(width, height);
+    int cursor = topMargin - topOffset - fontSize;
 
     for (const auto& paragraph : textSegments) {
         for (const auto& line : paragraph) {
@@ -76,8 +188,53 @@ void PngTextWriter::writeText() {
         }
         cursor -= paragraphSpacing;
     }
-    
-    saveAndClose();
+
+    if (!marker.empty()) {
+        writeMarker(marker);
+    }
+    timings.drawMs += elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    std::string imageData = PngEncoder::encode(canvas, fontColor, backgroundColor, pngOptions, exifData);
+    timings.encodeMs += elapsedMs(start);
+
+    return imageData;
+}
+
+const RenderTimings& PngTextWriter::getTimings() const {
+    return timings;
+}
+
+int PngTextWriter::getWidth() const {
+    return width;
+}
+
+int PngTextWriter::getHeight() const {
+    return height;
+}
+
+// Everything the encoded image depends on, with strings length-prefixed so fields cannot run together
+std::string PngTextWriter::getCacheKey(const std::string& exifData) const {
+    std::ostringstream key;
+    key.precision(9);
+    auto addString = [&key](const std::string& value) {
+        key << value.size() << ':' << value << ';';
+    };
+
+    key << RENDER_VERSION << ';' << paragraphs.size() << ';';
+    for (const std::string& paragraph : paragraphs) {
+        addString(paragraph);
+    }
+    addString(fontPath);
+    addString(textAlignment);
+    key << fontSize << ';' << fontColor.red << ',' << fontColor.green << ',' << fontColor.blue << ';'
+        << backgroundColor.red << ',' << backgroundColor.green << ',' << backgroundColor.blue << ';'
+        << aspectRatioWidth << ':' << aspectRatioHeight << ';' << margins << ';' << alwaysUseDescenderSpacing << ';'
+        << (int) pngOptions.colorMode << ',' << pngOptions.compressionLevel << ',' << (int) pngOptions.filter << ','
+        << (int) pngOptions.strategy << ';' << showLineBorders << ';';
+    addString(exifData);
+
+    return key.str();
 }
 
 void PngTextWriter::setDimensions(int newHeight) {
@@ -89,40 +246,20 @@ void PngTextWriter::setDimensions(int newHeight) {
     topMargin = round(height * (1.0 - margins));
     textAreaWidth = rightMargin - leftMargin;
     textAreaHeight = topMargin - bottomMargin;
-    image.resize(width, height);
 };
 
-void PngTextWriter::increaseImageSize() {
-    setDimensions(height + heightDelta);
-};
+TextLayout::TextArea PngTextWriter::textAreaForHeight(int imageHeight) {
+    int imageWidth = round(imageHeight * aspectRatio);
+    TextLayout::TextArea textArea;
+    textArea.width = (int) round(imageWidth * (1.0 - margins)) - (int) round(imageWidth * margins);
+    textArea.height = (int) round(imageHeight * (1.0 - margins)) - (int) round(imageHeight * margins);
+    return textArea;
+}
 
 int PngTextWriter::getTextWidth(const std::string& word) {
-    char * wordCopy = new char[word.length() + 1];
-    strcpy(wordCopy, word.c_str());
-    
-    int wordWidth = image.get_text_width_utf8(font, fontSize, wordCopy);
-    
-    delete[] wordCopy;
-    
-    return wordWidth;
+    return GlyphAdvanceCache::getInstance().getTextWidth(fontPath, fontSize, word);
 };
 
-bool PngTextWriter::fitsInHeight(int textHeight) {
-    if (textHeight > textAreaHeight) {
-        return false;
-    }
-    
-    return true;
-};
-
-bool PngTextWriter::fitsInWidth(int textWidth) {
-    if (textWidth > textAreaWidth) {
-        return false;
-    }
-    
-    return true;
-}
-
 bool PngTextWriter::lineHasDescenders(const std::string& line) {
     return StringUtils::stringContainsElement(line, DESCENDERS);
 }
@@ -131,123 +268,67 @@ int PngTextWriter::getLineHeight(const std::string& line) {
     return fontSize + ((lineHasDescenders(line) || alwaysUseDescenderSpacing) ? descenderSpacing : 0);
 }
 
-bool PngTextWriter::isFirstLineOfText(int lineNumber, int paragraphNumber) {
-    return (lineNumber == 0 && paragraphNumber == 0);
+// Building the layout is when every word gets measured
+TextLayout PngTextWriter::createLayout() {
+    auto start = std::chrono::steady_clock::now();
+    TextLayout::Spacing spacing = {fontSize, descenderSpacing, lineSpacing, paragraphSpacing, alwaysUseDescenderSpacing};
+    TextLayout layout(paragraphs, spaceWidth, [this](const std::string& word) { return getTextWidth(word); }, spacing);
+    timings.measureMs += elapsedMs(start);
+    return layout;
 }
 
-bool PngTextWriter::isFirstParagraph(int paragraphNumber) {
-    return (paragraphNumber == 0);
-}
+std::vector<std::vector<std::string>> PngTextWriter::fitImage() {
+    TextLayout layout = createLayout();
+    auto start = std::chrono::steady_clock::now();
 
-bool PngTextWriter::isLastWordInParagraph(int wordNumber, int wordCount) {
-    return (wordNumber + 1 == wordCount);
-}
+    int initialHeight = height;
+    int steps = layout.findSmallestFittingStep([this, initialHeight](int step) {
+        return textAreaForHeight(initialHeight + step * heightDelta);
+    });
 
-int PngTextWriter::calculateSpacing(const std::string& line, int lineNumber, int paragraphNumber) {
-    if (isFirstLineOfText(lineNumber, paragraphNumber)) {
-        return getLineHeight(line);
-    }
-    
-    return lineSpacing + getLineHeight(line);
-}
+    setDimensions(initialHeight + steps * heightDelta);
+    textHeight = layout.getTextHeight(textAreaWidth);
+    std::vector<std::vector<std::string>> lines = layout.getLines(textAreaWidth);
 
-std::vector<std::vector<std::string>> PngTextWriter::fitImage() {
-    std::vector<std::vector<std::string>> textSegments;
-    bool imageBigEnough = false;
-    while (!imageBigEnough) {
-        imageBigEnough = fitImage(textSegments);
-        if (!imageBigEnough) {
-            textSegments.clear();
-            increaseImageSize();
-        }
-    }
-    return textSegments;
+    timings.layoutMs += elapsedMs(start);
+    return lines;
 }
 
-bool PngTextWriter::fitImage(std::vector<std::vector<std::string>>& textSegments) {
-    textHeight = 0;
-
-    for (int j = 0; j < paragraphCount; j++) {
-        std::vector<std::string> words = StringUtils::splitSentence(paragraphs.at(j));
-        std::string line = "";
-        int runningLineWidth = 0;
-        int lineCount = 0;
-        textSegments.push_back(std::vector<std::string>());
+void PngTextWriter::drawText(SizedFont& font, int startX, int startY, const std::string& line) {
+    // pngwriter's plot_text_utf8 seeds the 26.6 pen with y_start / 64, which gives each line
+    // a vertical sub-pixel phase; the x origin is always whole pixels, so it stays at 0
+    FT_Vector pen = {0, (FT_Pos) (startY / 64.0)};
+    FT_UInt previousGlyph = 0;
 
-        if (!isFirstParagraph(j)) {
-            textHeight += paragraphSpacing;
+    for (char32_t codepoint : StringUtils::decodeUtf8(line)) {
+        FT_UInt glyphIndex = font.getGlyphIndex(codepoint);
 
-            if (!fitsInHeight(textHeight)) {
-                return false;
-            }
+        if (font.hasKerning() && previousGlyph && glyphIndex) {
+            pen.x += font.getKerning(previousGlyph, glyphIndex);
         }
-        
-        int paragraphWordCount = words.size();
-        for (int i = 0; i < paragraphWordCount; i++) {
-            // Adding a space between words
-            if (line.length() > 0) {
-                runningLineWidth += spaceWidth;
-            }
-
-            int wordWidth = getTextWidth(words.at(i));
-            
-            // Single word is too big for the text area
-            if (!fitsInWidth(wordWidth)) {
-                return false;
-            }
-            
-            runningLineWidth += wordWidth;
-            
-            if (fitsInWidth(runningLineWidth)) {
-                if (line.length() > 0) {
-                    line += " ";
-                }
-                
-                line += words.at(i);
-
-                if (isLastWordInParagraph(i, paragraphWordCount)) {
-                    
-                    textHeight += calculateSpacing(line, lineCount, j);
-                    textSegments.at(j).push_back(line);
-
-                    if (!fitsInHeight(textHeight)) {
-                        return false;
-                    }
-                }
-            } else {
-                runningLineWidth -= (spaceWidth + wordWidth);
-
-                textHeight += calculateSpacing(line, lineCount, j);
-                textSegments.at(j).push_back(line);
-
-                if (!fitsInHeight(textHeight)) {
-                    return false;
-                }
-                
-                lineCount += 1;
-                line = "";
-                i -= 1; // Try the same word on the next line
-                runningLineWidth = 0;
-            }
-        }
-    }
 
-    return true;
-    
-};
+        int offsetX;
+        int offsetY;
+        const GlyphBitmap& glyph = GlyphAtlas::getInstance().getGlyph(font, glyphIndex, pen, offsetX, offsetY);
+        drawGlyph(glyph, startX + glyph.left + offsetX, startY + glyph.top + offsetY);
 
-void PngTextWriter::drawText(int startX, int startY, const std::string& line) {
-    char * lineCopy = new char[line.length() + 1];
-    strcpy(lineCopy, line.c_str());
-    image.plot_text_utf8(font, fontSize, startX, startY, 0.0, lineCopy, red, green, blue);
-    delete[] lineCopy;
+        pen.x += glyph.advance;
+        previousGlyph = glyphIndex;
+    }
+}
+
+// Blends the glyph coverage over the canvas, matching pngwriter's bitmap placement
+void PngTextWriter::drawGlyph(const GlyphBitmap& glyph, int x, int y) {
+    for (int j = 1; j <= glyph.rows; j++) {
+        canvas.blendRow(x + 1, y - j, &glyph.coverage[(j - 1) * glyph.width], glyph.width);
+    }
 }
 
 void PngTextWriter::drawBoxAroundText(int startX, int startY, int lineWidth, bool hasDescenders) {
     startY = startY - (hasDescenders * descenderSpacing);
     int endY = startY + fontSize;
     int endX = startX + lineWidth;
-    image.square(startX, startY, endX, endY, 1.0, 0.0, 0.0);
+    canvas.addOutline(startX, startY, endX, endY);
 }
 
 void PngTextWriter::writeLine(const std::string& line, int startY) {
@@ -270,9 +351,12 @@ void PngTextWriter::writeLine(const std::string& line, int startY) {
         drawBoxAroundText(startX, startY, lineWidth, lineHasDescenders(line));
     }
     
-    drawText(startX, startY, line);
+    drawText(*font, startX, startY, line);
 };
 
-void PngTextWriter::saveAndClose() {
-    image.close();
-}
\ No newline at end of file
+// The marker sits centered in the space reserved for it under the text
+void PngTextWriter::writeMarker(const std::string& marker) {
+    int markerWidth = GlyphAdvanceCache::getInstance().getTextWidth(fontPath, markerFont->getFontSize(), marker);
+    int startX = leftMargin + round((textAreaWidth - markerWidth) / 2);
+    drawText(*markerFont, startX, bottomMargin + descenderSpacing, marker);
+}
@@ -1,35 +1,69 @@
 #ifndef PNG_TEXT_WRITER_H
 #define PNG_TEXT_WRITER_H
 
-#include <pngwriter.h>
 #include <vector>
 #include <string>
+#include <memory>
+#include <functional>
+#include "text_layout.h"
+#include "font_manager.h"
+#include "coverage_canvas.h"
+#include "png_encoder.h"
+
+// Everything about how an entry is drawn, read from the config file once instead of per image
+struct RenderOptions {
+    std::string fontPath;
+    int fontSize;
+    Color fontColor;
+    std::string textAlignment;
+    int aspectRatioWidth;
+    int aspectRatioHeight;
+    float margins;
+    bool alwaysUseDescenderSpacing;
+    PngEncoder::Options pngOptions;
+    bool paginate;
+    bool showLineBorders;
+    bool useRenderCache;
+
+    static RenderOptions fromConfig();
+};
+
+// Wall-clock time spent in each rendering phase, summed over every image the writer produced
+struct RenderTimings {
+    double measureMs = 0;
+    double layoutMs = 0;
+    double drawMs = 0;
+    double encodeMs = 0;
+};
 
 class PngTextWriter {
     
 public:
     PngTextWriter(const std::vector<std::string>& paragraphs, const std::string& filename);
-    ~PngTextWriter();
+    PngTextWriter(const std::vector<std::string>& paragraphs, const std::string& filename, const RenderOptions& options);
     void writeText();
+    std::string renderImage(const std::string& exifData = "");
+    std::vector<std::string> renderPages(const std::string& exifData = "");
+    const RenderTimings& getTimings() const;
+    int getWidth() const;
+    int getHeight() const;
 
 private:
     void setDimensions(int newHeight);
-    void increaseImageSize();
+    TextLayout::TextArea textAreaForHeight(int imageHeight);
     int getTextWidth(const std::string& word);
-    bool fitsInHeight(int textHeight);
-    bool fitsInWidth(int textWidth);
     bool lineHasDescenders(const std::string& line);
     int getLineHeight(const std::string& line);
-    bool isFirstLineOfText(int lineNumber, int paragraphNumber);
-    bool isFirstParagraph(int paragraphNumber);
-    bool isLastWordInParagraph(int wordNumber, int wordCount);
-    int calculateSpacing(const std::string& line, int lineNumber, int paragraphNumber);
+    TextLayout createLayout();
     std::vector<std::vector<std::string>> fitImage();
-    bool fitImage(std::vector<std::vector<std::string>>& textSegments);
-    void drawText(int startX, int startY, const std::string& line);
+    std::string loadOrRender(const std::string& cacheKeyData, const std::function<std::string()>& render);
+    std::string drawPage(const std::vector<std::vector<std::string>>& textSegments, int topOffset, const std::string& marker, const std::string& exifData);
+    void drawText(SizedFont& font, int startX, int startY, const std::string& line);
+    void drawGlyph(const GlyphBitmap& glyph, int x, int y);
     void drawBoxAroundText(int startX, int startY, int lineWidth, bool hasDescenders);
     void writeLine(const std::string& line, int startY);
-    void saveAndClose();
+    void writeMarker(const std::string& marker);
+    std::string getCacheKey(const std::string& exifData) const;
     
 private:
     std::vector<std::string> paragraphs;
@@ -46,11 +80,13 @@ private:
     int topMargin;
     int textAreaWidth;
     int textAreaHeight;
-    char* font;
+    std::string fontPath;
+    std::shared_ptr<SizedFont> font;
+    std::shared_ptr<SizedFont> markerFont;
     int fontSize;
-    float red;
-    float green;
-    float blue;
+    Color fontColor;
+    Color backgroundColor;
+    PngEncoder::Options pngOptions;
     std::string textAlignment;
     bool alwaysUseDescenderSpacing;
     int descenderSpacing;
@@ -60,8 +96,11 @@ private:
     int textHeight;
     int paragraphCount;
     int heightDelta;
+    bool paginate;
     bool showLineBorders;
-    pngwriter image;
+    bool useRenderCache;
+    RenderTimings timings;
+    CoverageCanvas canvas;
 
 };
 
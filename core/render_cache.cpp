@@ -0,0 +1,216 @@
+#include "render_cache.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "../config/config_handler.h"
+
+namespace ConfigConst = ConfigConstants;
+
+const std::string EXTENSION = ".png";
+const std::string TEMPORARY_EXTENSION = ".tmp";
+const std::string PNG_SIGNATURE = "\x89PNG\r\n\x1a\n";
+const uintmax_t BYTES_PER_MB = 1024 * 1024;
+
+RenderCache& RenderCache::getInstance() {
+    static RenderCache instance;
+    return instance;
+}
+
+RenderCache::RenderCache() {
+    enabled = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::RENDER_CACHE, ConfigConst::ENABLED);
+    directory = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::RENDER_CACHE, ConfigConst::DIRECTORY).get<std::string>();
+    maxBytes = ConfigHandler::getInstance().getConfigValue(ConfigConst::SETTINGS, ConfigConst::RENDER_CACHE, ConfigConst::MAX_SIZE_MB).get<uintmax_t>() * BYTES_PER_MB;
+    totalBytes = 0;
+    temporaryCount = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+
+    if (enabled) {
+        try {
+            std::filesystem::create_directories(directory);
+            loadIndex();
+        } catch (const std::filesystem::filesystem_error& e) {
+            std::cerr << "Render cache disabled: " << e.what() << std::endl;
+            enabled = false;
+        }
+    }
+}
+
+// Two independent 64-bit FNV-1a hashes, so accidental collisions are not a practical concern
+std::string RenderCache::hashKey(const std::string& keyData) {
+    const uint64_t PRIME = 0x100000001b3ULL;
+    uint64_t first = 0xcbf29ce484222325ULL;
+    uint64_t second = 0x84222325cbf29ce4ULL;
+    for (unsigned char byte : keyData) {
+        first = (first ^ byte) * PRIME;
+        second = (second ^ (byte ^ 0x5c)) * PRIME;
+    }
+
+    std::ostringstream hash;
+    hash << std::hex << std::setfill('0') << std::setw(16) << first << std::setw(16) << second;
+    return hash.str();
+}
+
+bool RenderCache::isEnabled() const {
+    return enabled;
+}
+
+// Only the index is touched under the lock, so reads and writes on different threads overlap
+bool RenderCache::load(const std::string& key, std::string& imageData) {
+    if (!enabled) {
+        return false;
+    }
+
+    uintmax_t expectedSize;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = images.find(key);
+        if (found == images.end()) {
+            misses++;
+            return false;
+        }
+        expectedSize = found->second.size;
+    }
+
+    const std::filesystem::path path = getPath(key);
+    std::ifstream file(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // A file that was truncated or changed outside the program is rendered again
+    if (data.size() != expectedSize || data.compare(0, PNG_SIGNATURE.size(), PNG_SIGNATURE) != 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = images.find(key);
+        // Evicted or stored again by another thread while this one was reading
+        if (found != images.end() && found->second.size == expectedSize) {
+            std::cerr << "Discarding unreadable cached image: " << path << std::endl;
+            remove(key);
+        }
+        misses++;
+        return false;
+    }
+
+    const std::filesystem::file_time_type now = std::filesystem::file_time_type::clock::now();
+    std::error_code error;
+    std::filesystem::last_write_time(path, now, error);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = images.find(key);
+        if (found != images.end()) {
+            found->second.lastUsed = now;
+        }
+        hits++;
+    }
+
+    imageData = std::move(data);
+    return true;
+}
+
+// Failing to cache an image is not fatal; it is rendered again next time
+void RenderCache::store(const std::string& key, const std::string& imageData) {
+    if (!enabled || imageData.size() > maxBytes) {
+        return;
+    }
+
+    // Each store writes its own temporary file, so two threads storing the same key never share one
+    const std::filesystem::path path = getPath(key);
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += "." + std::to_string(temporaryCount++) + TEMPORARY_EXTENSION;
+
+    try {
+        {
+            std::ofstream file(temporaryPath, std::ios::binary);
+            file.write(imageData.data(), imageData.size());
+            if (!file) {
+                throw std::runtime_error("Unable to write " + temporaryPath.string());
+            }
+        }
+        // Renaming over the old file means a crash or a concurrent load never sees a partial image
+        std::filesystem::rename(temporaryPath, path);
+    } catch (const std::exception& e) {
+        std::cerr << "Unable to cache rendered image: " << e.what() << std::endl;
+        std::error_code error;
+        std::filesystem::remove(temporaryPath, error);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto existing = images.find(key);
+    if (existing != images.end()) {
+        totalBytes -= existing->second.size;
+    }
+    images[key] = {imageData.size(), std::filesystem::file_time_type::clock::now()};
+    totalBytes += imageData.size();
+
+    evict();
+}
+
+void RenderCache::printStats() {
+    if (!enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::cout << "Render cache: " << images.size() << " images (" << totalBytes << " bytes), " << hits << " hits, " << misses << " misses, " << evictions << " evicted" << std::endl;
+}
+
+std::filesystem::path RenderCache::getPath(const std::string& key) const {
+    return directory / (key + EXTENSION);
+}
+
+// The modification time of each file records when it was last used
+void RenderCache::loadIndex() {
+    for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(directory)) {
+        if (!file.is_regular_file()) {
+            continue;
+        }
+
+        std::filesystem::path path = file.path();
+        if (path.extension() == TEMPORARY_EXTENSION) {
+            // Left behind by a run that stopped while writing
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        } else if (path.extension() == EXTENSION) {
+            images[path.stem().string()] = {file.file_size(), file.last_write_time()};
+            totalBytes += file.file_size();
+        }
+    }
+
+    evict();
+}
+
+void RenderCache::remove(const std::string& key) {
+    auto found = images.find(key);
+    if (found == images.end()) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::remove(getPath(key), error);
+    totalBytes -= found->second.size;
+    images.erase(found);
+}
+
+void RenderCache::evict() {
+    if (totalBytes <= maxBytes) {
+        return;
+    }
+
+    std::vector<std::pair<std::filesystem::file_time_type, std::string>> byLastUse;
+    for (const auto& image : images) {
+        byLastUse.emplace_back(image.second.lastUsed, image.first);
+    }
+    std::sort(byLastUse.begin(), byLastUse.end());
+
+    for (const auto& image : byLastUse) {
+        if (totalBytes <= maxBytes) {
+            break;
+        }
+        remove(image.second);
+        evictions++;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// On-disk store of encoded images named by a hash of everything that went into rendering them.
+// The least recently used images are deleted once the directory grows past its size limit.
+class RenderCache {
+public:
+    static RenderCache& getInstance();
+    static std::string hashKey(const std::string& keyData);
+    bool isEnabled() const;
+    bool load(const std::string& key, std::string& imageData);
+    void store(const std::string& key, const std::string& imageData);
+    void printStats();
+
+private:
+    struct CachedImage {
+        uintmax_t size;
+        std::filesystem::file_time_type lastUsed;
+    };
+
+    RenderCache();
+    RenderCache(const RenderCache&) = delete;
+    RenderCache& operator=(const RenderCache&) = delete;
+    std::filesystem::path getPath(const std::string& key) const;
+    void loadIndex();
+    void remove(const std::string& key);
+    void evict();
+
+private:
+    bool enabled;
+    std::filesystem::path directory;
+    uintmax_t maxBytes;
+    uintmax_t totalBytes;
+    std::unordered_map<std::string, CachedImage> images;
+    std::mutex mutex;
+    std::atomic<unsigned long> temporaryCount;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+
+};
+
+#endif // RENDER_CACHE_H
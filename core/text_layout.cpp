@@ -0,0 +1,214 @@
+#include "text_layout.h"
+#include "../utils/string_utils.h"
+
+const std::string DESCENDERS = "gjpqy";
+
+TextLayout::TextLayout(const std::vector<std::string>& paragraphs, int spaceWidth, const std::function<int(const std::string&)>& measureWord, const Spacing& spacing) {
+    this->spaceWidth = spaceWidth;
+    this->spacing = spacing;
+    widestWord = 0;
+
+    for (std::string paragraph : paragraphs) {
+        MeasuredParagraph measured;
+        measured.words = StringUtils::splitSentence(paragraph);
+
+        for (const std::string& word : measured.words) {
+            int wordWidth = measureWord(word);
+            widestWord = std::max(widestWord, wordWidth);
+            measured.widths.push_back(wordWidth);
+            measured.descenders.push_back(StringUtils::stringContainsElement(word, DESCENDERS));
+        }
+
+        this->paragraphs.push_back(measured);
+    }
+}
+
+// Finds the first step at which all text fits, exactly as growing the image one step at a time would.
+// Line counts only shrink as the text area widens, so fitting is monotone when every line is assumed
+// to have (or lack) descenders. Those two bounds are binary searched and only the steps between them
+// are checked with the real line heights.
+int TextLayout::findSmallestFittingStep(const std::function<TextArea(int step)>& textAreaForStep) const {
+    int lowerBound = searchSmallestStep(textAreaForStep, 0, HeightEstimate::NO_DESCENDERS);
+    int upperBound = searchSmallestStep(textAreaForStep, lowerBound, HeightEstimate::ALL_DESCENDERS);
+
+    for (int step = lowerBound; step < upperBound; step++) {
+        if (fits(textAreaForStep(step), HeightEstimate::ACTUAL)) {
+            return step;
+        }
+    }
+
+    return upperBound;
+}
+
+std::vector<std::vector<std::string>> TextLayout::getLines(int textAreaWidth) const {
+    std::vector<std::vector<std::string>> textSegments;
+    std::vector<std::vector<Line>> lines = breakLines(textAreaWidth);
+
+    for (size_t j = 0; j < lines.size(); j++) {
+        textSegments.push_back(std::vector<std::string>());
+
+        for (const Line& line : lines.at(j)) {
+            textSegments.at(j).push_back(joinWords(paragraphs.at(j), line));
+        }
+    }
+
+    return textSegments;
+}
+
+int TextLayout::getTextHeight(int textAreaWidth) const {
+    return measureHeight(breakLines(textAreaWidth), HeightEstimate::ACTUAL);
+}
+
+bool TextLayout::fitsWidth(int textAreaWidth) const {
+    return widestWord <= textAreaWidth;
+}
+
+// Fills pages top to bottom with the lines for the area's width, using the same spacing rules as
+// measureHeight. The first line on each page gets no line or paragraph spacing above it.
+std::vector<TextLayout::Page> TextLayout::paginate(const TextArea& textArea) const {
+    std::vector<Page> pages(1, {{}, 0});
+    std::vector<std::vector<Line>> lines = breakLines(textArea.width);
+
+    for (size_t j = 0; j < lines.size(); j++) {
+        bool startsParagraph = true;
+
+        for (const Line& line : lines.at(j)) {
+            int lineHeight = getLineHeight(line.hasDescenders);
+            Page* page = &pages.back();
+
+            int spacingAbove = 0;
+            if (!page->lines.empty()) {
+                spacingAbove = spacing.lineSpacing + (startsParagraph ? spacing.paragraphSpacing : 0);
+            }
+
+            // A line taller than the page still gets a page of its own
+            if (!page->lines.empty() && page->textHeight + spacingAbove + lineHeight > textArea.height) {
+                pages.push_back({{}, 0});
+                page = &pages.back();
+                spacingAbove = 0;
+                startsParagraph = true;
+            }
+
+            if (startsParagraph) {
+                page->lines.push_back(std::vector<std::string>());
+                startsParagraph = false;
+            }
+            page->lines.back().push_back(joinWords(paragraphs.at(j), line));
+            page->textHeight += spacingAbove + lineHeight;
+        }
+    }
+
+    return pages;
+}
+
+std::vector<std::vector<TextLayout::Line>> TextLayout::breakLines(int textAreaWidth) const {
+    std::vector<std::vector<Line>> lines;
+
+    for (const MeasuredParagraph& paragraph : paragraphs) {
+        lines.push_back(std::vector<Line>());
+        Line line = {0, 0, false};
+        int lineWidth = 0;
+
+        for (size_t i = 0; i < paragraph.words.size(); i++) {
+            int wordWidth = paragraph.widths.at(i);
+            int candidateWidth = (line.wordCount > 0) ? lineWidth + spaceWidth + wordWidth : wordWidth;
+
+            // The word moves to the next line unless it is the only word on this one
+            if (line.wordCount > 0 && candidateWidth > textAreaWidth) {
+                lines.back().push_back(line);
+                line = {i, 0, false};
+                candidateWidth = wordWidth;
+            }
+
+            lineWidth = candidateWidth;
+            line.wordCount++;
+            line.hasDescenders = line.hasDescenders || paragraph.descenders.at(i);
+        }
+
+        if (line.wordCount > 0) {
+            lines.back().push_back(line);
+        }
+    }
+
+    return lines;
+}
+
+std::string TextLayout::joinWords(const MeasuredParagraph& paragraph, const Line& line) const {
+    std::string text = "";
+    for (size_t i = line.firstWord; i < line.firstWord + line.wordCount; i++) {
+        if (text.length() > 0) {
+            text += " ";
+        }
+        text += paragraph.words.at(i);
+    }
+    return text;
+}
+
+int TextLayout::getLineHeight(bool hasDescenders) const {
+    return spacing.fontSize + ((hasDescenders || spacing.alwaysUseDescenderSpacing) ? spacing.descenderSpacing : 0);
+}
+
+int TextLayout::measureHeight(const std::vector<std::vector<Line>>& lines, HeightEstimate estimate) const {
+    int textHeight = 0;
+
+    for (size_t j = 0; j < lines.size(); j++) {
+        if (j > 0) {
+            textHeight += spacing.paragraphSpacing;
+        }
+
+        for (size_t i = 0; i < lines.at(j).size(); i++) {
+            bool hasDescenders = lines.at(j).at(i).hasDescenders;
+            if (estimate == HeightEstimate::NO_DESCENDERS) {
+                hasDescenders = false;
+            } else if (estimate == HeightEstimate::ALL_DESCENDERS) {
+                hasDescenders = true;
+            }
+
+            int lineHeight = getLineHeight(hasDescenders);
+
+            // Only the very first line of text is placed without line spacing
+            if (i == 0 && j == 0) {
+                textHeight += lineHeight;
+            } else {
+                textHeight += spacing.lineSpacing + lineHeight;
+            }
+        }
+    }
+
+    return textHeight;
+}
+
+bool TextLayout::fits(const TextArea& textArea, HeightEstimate estimate) const {
+    // A single word that is too wide can never be placed
+    if (widestWord > textArea.width) {
+        return false;
+    }
+
+    return measureHeight(breakLines(textArea.width), estimate) <= textArea.height;
+}
+
+int TextLayout::searchSmallestStep(const std::function<TextArea(int step)>& textAreaForStep, int firstStep, HeightEstimate estimate) const {
+    if (fits(textAreaForStep(firstStep), estimate)) {
+        return firstStep;
+    }
+
+    // Gallop to a fitting step, then binary search the gap behind it
+    int failing = firstStep;
+    int distance = 1;
+    while (!fits(textAreaForStep(failing + distance), estimate)) {
+        failing += distance;
+        distance *= 2;
+    }
+    int fitting = failing + distance;
+
+    while (fitting - failing > 1) {
+        int middle = failing + (fitting - failing) / 2;
+        if (fits(textAreaForStep(middle), estimate)) {
+            fitting = middle;
+        } else {
+            failing = middle;
+        }
+    }
+
+    return fitting;
+}
@@ -0,0 +1,73 @@
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Breaks paragraphs into lines with the same greedy rules PngTextWriter has always used.
+// Every word is measured once up front so that many candidate image sizes can be tried cheaply.
+class TextLayout {
+public:
+    struct Spacing {
+        int fontSize;
+        int descenderSpacing;
+        int lineSpacing;
+        int paragraphSpacing;
+        bool alwaysUseDescenderSpacing;
+    };
+
+    struct TextArea {
+        int width;
+        int height;
+    };
+
+    // Lines are grouped by paragraph as in getLines, so a paragraph split across pages
+    // ends one page's groups and starts the next page's
+    struct Page {
+        std::vector<std::vector<std::string>> lines;
+        int textHeight;
+    };
+
+    TextLayout(const std::vector<std::string>& paragraphs, int spaceWidth, const std::function<int(const std::string&)>& measureWord, const Spacing& spacing);
+    int findSmallestFittingStep(const std::function<TextArea(int step)>& textAreaForStep) const;
+    std::vector<std::vector<std::string>> getLines(int textAreaWidth) const;
+    int getTextHeight(int textAreaWidth) const;
+    bool fitsWidth(int textAreaWidth) const;
+    std::vector<Page> paginate(const TextArea& textArea) const;
+
+private:
+    struct Line {
+        size_t firstWord;
+        size_t wordCount;
+        bool hasDescenders;
+    };
+
+    struct MeasuredParagraph {
+        std::vector<std::string> words;
+        std::vector<int> widths;
+        std::vector<bool> descenders;
+    };
+
+    enum class HeightEstimate {
+        ACTUAL,
+        NO_DESCENDERS,
+        ALL_DESCENDERS
+    };
+
+    std::vector<std::vector<Line>> breakLines(int textAreaWidth) const;
+    std::string joinWords(const MeasuredParagraph& paragraph, const Line& line) const;
+    int getLineHeight(bool hasDescenders) const;
+    int measureHeight(const std::vector<std::vector<Line>>& lines, HeightEstimate estimate) const;
+    bool fits(const TextArea& textArea, HeightEstimate estimate) const;
+    int searchSmallestStep(const std::function<TextArea(int step)>& textAreaForStep, int firstStep, HeightEstimate estimate) const;
+
+private:
+    std::vector<MeasuredParagraph> paragraphs;
+    int spaceWidth;
+    int widestWord;
+    Spacing spacing;
+
+};
+
+#endif // TEXT_LAYOUT_H
@@ -11,14 +11,25 @@ and loads the entries to a Google Sheet.
 #include <iostream>
 #include <string>
 #include <vector>
+#include <curl/curl.h>
 #include "config/config_handler.h"
 #include "core/entry.h"
 #include "core/entry_extractor.h"
 #include "core/google_docs_entry_extractor.h"
 #include "core/png_text_writer.h"
+#include "core/entry_pipeline.h"
+#include "core/glyph_advance_cache.h"
+#include "core/font_manager.h"
+#include "core/glyph_atlas.h"
+#include "core/render_cache.h"
 #include "api/google_api_handler.h"
+#include "api/http_client.h"
+#include "api/request_scheduler.h"
+#include "api/upload_engine.h"
 #include "utils/file_utils.h"
 
+namespace ConfigConst = ConfigConstants;
+
 std::vector<Entry> extractEntries(GoogleAPIHandler& googleAPIHandler) {
     std::vector<std::unique_ptr<EntryExtractor>> entryExtractors;
     entryExtractors.push_back(std::make_unique<GoogleDocsEntryExtractor>(googleAPIHandler.getDoc()));
@@ -33,28 +44,19 @@ std::vector<Entry> extractEntries(GoogleAPIHandler& googleAPIHandler) {
     return entries;
 }
 
-void processEntries(const std::string& projectPath, std::vector<Entry>& entries, GoogleAPIHandler& googleAPIHandler) {
-    
-    std::vector<std::vector<std::string>> rowEntries;
-    int entryCount = entries.size();
-    int currentEntry = 0;
-    for (Entry& entry : entries) {
-        std::cout << std::endl << "Processing entry " << ++currentEntry << " of " << entryCount << std::endl;
-
-        std::string filename = entry.toFilename();
-        PngTextWriter pngTextWriter(entry.getTitle(), filename);
-        pngTextWriter.writeText();
-        
-        FileUtils::updateExifOriginalDate(projectPath + filename, entry.getExifDatetime(), entry.getTimeOffset());
+void processEntries(const std::string& projectPath, GoogleAPIHandler& googleAPIHandler) {
+    FontManager::getInstance().preloadConfiguredFonts();
 
-        std::string photosId = googleAPIHandler.uploadPhoto(projectPath, filename, entry.generatePhotosDescription());
-        entry.setPhotosId(photosId);
-        FileUtils::deleteFile(filename);
+    EntryPipeline pipeline(projectPath, googleAPIHandler, EntryPipeline::Settings::fromConfig(), RenderOptions::fromConfig());
+    pipeline.run([&googleAPIHandler]() { return extractEntries(googleAPIHandler); });
 
-        rowEntries.push_back(entry.toVector());
-    }
-
-    googleAPIHandler.appendRowsToSheet(rowEntries);
+    FontManager::getInstance().printStats();
+    GlyphAdvanceCache::getInstance().printStats();
+    GlyphAtlas::getInstance().printStats();
+    RenderCache::getInstance().printStats();
+    HttpClient::getInstance().printStats();
+    UploadEngine::getInstance().printStats();
+    RequestScheduler::getInstance().printStats();
 }
 
 int main() {
@@ -62,9 +64,11 @@ int main() {
         const std::string projectPath = FileUtils::getExecutableDirectory();
         FileUtils::setCurrentPath(projectPath);
 
+        // libcurl's global setup is not thread-safe, so it has to happen before the pipeline starts
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+
         GoogleAPIHandler googleAPIHandler = GoogleAPIHandler();
-        std::vector<Entry> entries = extractEntries(googleAPIHandler);
-        processEntries(projectPath, entries, googleAPIHandler);
+        processEntries(projectPath, googleAPIHandler);
     }
     catch (const std::exception& e) {
         std::cerr << "An error occurred: " << e.what() << std::endl;
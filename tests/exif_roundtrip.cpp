@@ -0,0 +1,67 @@
+/*
+Round-trip check for the eXIf chunk PngEncoder writes.
+
+Encodes a small canvas with the block from ExifUtils::buildOriginalDateExif, opens the PNG bytes
+with Exiv2 and checks that DateTimeOriginal and OffsetTimeOriginal read back unchanged.
+Exits non-zero when either tag is missing or different.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exiv2/exiv2.hpp>
+#include "../core/coverage_canvas.h"
+#include "../core/png_encoder.h"
+#include "../utils/exif_utils.h"
+
+const int WIDTH = 70;
+const int HEIGHT = 90;
+const std::string TIMESTAMP = "2025:05:09 22:34:00";
+const std::string OFFSET = "-07:00";
+
+bool checkTag(const Exiv2::ExifData& exifData, const std::string& key, const std::string& expected) {
+    Exiv2::ExifData::const_iterator datum = exifData.findKey(Exiv2::ExifKey(key));
+    if (datum == exifData.end()) {
+        std::cerr << key << " missing" << std::endl;
+        return false;
+    }
+
+    const std::string actual = datum->toString();
+    if (actual != expected) {
+        std::cerr << key << " read back as \"" << actual << "\", expected \"" << expected << "\"" << std::endl;
+        return false;
+    }
+
+    std::cout << key << " = " << actual << std::endl;
+    return true;
+}
+
+int main() {
+    CoverageCanvas canvas;
+    canvas.resize(WIDTH, HEIGHT);
+    const std::vector<uint8_t> coverage(WIDTH / 2, 255);
+    for (int y = HEIGHT / 4; y < HEIGHT / 2; y++) {
+        canvas.blendRow(WIDTH / 4, y, coverage.data(), coverage.size());
+    }
+
+    const std::string exifData = ExifUtils::buildOriginalDateExif(TIMESTAMP, OFFSET);
+    const PngEncoder::Options options = PngEncoder::parseOptions("palette", 6, "none", "rle", false);
+    const std::string png = PngEncoder::encode(canvas, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, options, exifData);
+
+    try {
+        Exiv2::Image::UniquePtr image = Exiv2::ImageFactory::open(reinterpret_cast<const Exiv2::byte*>(png.data()), png.size());
+        if (!image) {
+            std::cerr << "Exiv2 could not open the encoded PNG" << std::endl;
+            return 1;
+        }
+        image->readMetadata();
+
+        bool passed = checkTag(image->exifData(), "Exif.Photo.DateTimeOriginal", TIMESTAMP);
+        passed = checkTag(image->exifData(), "Exif.Photo.OffsetTimeOriginal", OFFSET) && passed;
+        std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+        return passed ? 0 : 1;
+    } catch (const Exiv2::Error& e) {
+        std::cerr << "Exiv2 error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,193 @@
+/*
+Drives ResumableUpload against a fake upload server on 127.0.0.1.
+
+The server speaks Google's resumable protocol with a 256 KiB chunk granularity, and fails twice:
+it keeps only part of the second chunk and drops the connection without answering, then it
+stores the final chunk but loses the response. The upload has to query the offset straight after
+the dropped chunk, resume from what the server reports, and pick up the token from the final query.
+Every request must also carry a freshly fetched access token. Exits non-zero on any failure.
+
+Run it from the project directory after setup, since the request scheduler reads config/config.json.
+*/
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <curl/curl.h>
+#include "../api/resumable_upload.h"
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = asio::ip::tcp;
+
+const uint64_t GRANULARITY = 256 * 1024;
+const uint64_t CHUNK_SIZE = 2 * GRANULARITY;
+const uint64_t UPLOAD_SIZE = 5 * GRANULARITY + 100000;
+const uint64_t DROPPED_CHUNK_OFFSET = CHUNK_SIZE;
+// How much of the dropped chunk the server keeps
+const uint64_t KEPT_BYTES = GRANULARITY;
+const std::string UPLOAD_TOKEN = "fake-upload-token";
+const int MAX_ATTEMPTS = 3;
+
+struct LoggedRequest {
+    std::string command;
+    uint64_t offset;
+    std::string accessToken;
+};
+
+// Fake server side of the resumable protocol, answering one request per connection
+class FakeUploadServer {
+public:
+    FakeUploadServer() : acceptor(ioc, tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0)), finished(false), droppedChunk(false), lostFinalResponse(false) {}
+
+    std::string getUploadUrl() const {
+        return "http://127.0.0.1:" + std::to_string(acceptor.local_endpoint().port()) + "/upload";
+    }
+
+    void run() {
+        while (true) {
+            tcp::socket socket(ioc);
+            acceptor.accept(socket);
+            handle(socket);
+        }
+    }
+
+    std::vector<LoggedRequest> getLog() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return log;
+    }
+
+    std::string getReceived() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received;
+    }
+
+private:
+    void handle(tcp::socket& socket) {
+        beast::flat_buffer buffer;
+        http::request_parser<http::string_body> parser;
+        parser.body_limit(UPLOAD_SIZE * 2);
+        beast::error_code error;
+        http::read(socket, buffer, parser, error);
+        if (error) {
+            return;
+        }
+
+        http::request<http::string_body>& request = parser.get();
+        const std::string command(request["X-Goog-Upload-Command"]);
+        const std::string offsetHeader(request["X-Goog-Upload-Offset"]);
+        const uint64_t offset = offsetHeader.empty() ? 0 : std::stoull(offsetHeader);
+        std::string authorization(request[http::field::authorization]);
+        const std::string BEARER = "Bearer ";
+        const std::string accessToken = authorization.compare(0, BEARER.size(), BEARER) == 0 ? authorization.substr(BEARER.size()) : "";
+
+        http::response<http::string_body> response{http::status::ok, request.version()};
+        response.keep_alive(false);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        log.push_back({command, offset, accessToken});
+
+        if (command == "start") {
+            response.set("X-Goog-Upload-URL", "http://127.0.0.1:" + std::to_string(acceptor.local_endpoint().port()) + "/session");
+            response.set("X-Goog-Upload-Chunk-Granularity", std::to_string(GRANULARITY));
+        } else if (command == "query") {
+            if (finished) {
+                response.set("X-Goog-Upload-Status", "final");
+                response.body() = UPLOAD_TOKEN;
+            } else {
+                response.set("X-Goog-Upload-Status", "active");
+                response.set("X-Goog-Upload-Size-Received", std::to_string(received.size()));
+            }
+        } else if (offset != received.size()) {
+            response.result(http::status::bad_request);
+        } else if (offset == DROPPED_CHUNK_OFFSET && !droppedChunk) {
+            droppedChunk = true;
+            received += request.body().substr(0, KEPT_BYTES);
+            socket.shutdown(tcp::socket::shutdown_both, error);
+            return;
+        } else {
+            received += request.body();
+            if (command == "upload, finalize") {
+                finished = true;
+                if (!lostFinalResponse) {
+                    lostFinalResponse = true;
+                    socket.shutdown(tcp::socket::shutdown_both, error);
+                    return;
+                }
+                response.body() = UPLOAD_TOKEN;
+            } else {
+                response.set("X-Goog-Upload-Status", "active");
+            }
+        }
+
+        response.prepare_payload();
+        http::write(socket, response, error);
+        socket.shutdown(tcp::socket::shutdown_both, error);
+    }
+
+private:
+    asio::io_context ioc;
+    tcp::acceptor acceptor;
+    std::mutex mutex;
+    std::vector<LoggedRequest> log;
+    std::string received;
+    bool finished;
+    bool droppedChunk;
+    bool lostFinalResponse;
+
+};
+
+bool check(bool condition, const std::string& description) {
+    std::cout << (condition ? "ok   " : "FAIL ") << description << std::endl;
+    return condition;
+}
+
+int main() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    FakeUploadServer server;
+    std::thread(&FakeUploadServer::run, &server).detach();
+
+    std::string data(UPLOAD_SIZE, '\0');
+    for (uint64_t i = 0; i < UPLOAD_SIZE; i++) {
+        data[i] = static_cast<char>((i * 31 + i / 7) & 0xFF);
+    }
+
+    std::atomic<int> tokensFetched(0);
+    ResumableUpload::TokenProvider getAccessToken = [&tokensFetched]() {
+        return "access-" + std::to_string(++tokensFetched);
+    };
+
+    const std::string uploadToken = ResumableUpload::upload(getAccessToken, server.getUploadUrl(), {data, "", UPLOAD_SIZE}, CHUNK_SIZE, MAX_ATTEMPTS);
+    const std::vector<LoggedRequest> log = server.getLog();
+
+    for (const LoggedRequest& request : log) {
+        std::cout << "  " << request.command << " @" << request.offset << " with " << request.accessToken << std::endl;
+    }
+
+    bool passed = check(uploadToken == UPLOAD_TOKEN, "upload returns the token from the final query");
+    passed = check(server.getReceived() == data, "server holds exactly the uploaded bytes") && passed;
+
+    size_t dropped = 0;
+    while (dropped < log.size() && !(log[dropped].command == "upload" && log[dropped].offset == DROPPED_CHUNK_OFFSET)) {
+        dropped++;
+    }
+    passed = check(dropped + 2 < log.size() && log[dropped + 1].command == "query", "dropped chunk goes straight to the offset query") && passed;
+    passed = check(dropped + 2 < log.size() && log[dropped + 2].offset == DROPPED_CHUNK_OFFSET + KEPT_BYTES, "upload resumes from the reported offset") && passed;
+    passed = check(!log.empty() && log.back().command == "query", "lost final response is recovered by a query") && passed;
+
+    bool freshTokens = static_cast<int>(log.size()) == tokensFetched;
+    for (size_t i = 0; i < log.size(); i++) {
+        freshTokens = freshTokens && log[i].accessToken == "access-" + std::to_string(i + 1);
+    }
+    passed = check(freshTokens, "every request fetches the access token again") && passed;
+
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// Blocking FIFO with a fixed capacity for handing work between threads.
+// Closing it lets consumers drain what is left; cancelling it drops the remaining items too.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity);
+
+    // Blocks while the queue is full. Returns false if the queue was closed instead.
+    bool push(T item);
+    // Blocks while the queue is empty. Returns false once it is closed and drained.
+    bool pop(T& item);
+    void close();
+    void cancel();
+
+private:
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+private:
+    size_t capacity;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    bool closed;
+
+};
+
+#include "bounded_queue.tpp"
+
+#endif // BOUNDED_QUEUE_H
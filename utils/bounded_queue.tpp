@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <utility>
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity) : capacity(std::max<size_t>(1, capacity)), closed(false) {}
+
+template <typename T>
+bool BoundedQueue<T>::push(T item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+    if (closed) {
+        return false;
+    }
+
+    items.push_back(std::move(item));
+    notEmpty.notify_one();
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+    if (items.empty()) {
+        return false;
+    }
+
+    item = std::move(items.front());
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+}
+
+template <typename T>
+void BoundedQueue<T>::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    notFull.notify_all();
+    notEmpty.notify_all();
+}
+
+template <typename T>
+void BoundedQueue<T>::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    items.clear();
+    notFull.notify_all();
+    notEmpty.notify_all();
+}
@@ -0,0 +1,37 @@
+#include "byte_budget.h"
+#include <algorithm>
+
+ByteBudget::ByteBudget(size_t maxBytes) : maxBytes(maxBytes), usedBytes(0), peakBytes(0), closed(false) {}
+
+bool ByteBudget::acquire(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait(lock, [this, bytes]() { return closed || usedBytes == 0 || usedBytes + bytes <= maxBytes; });
+    if (closed) {
+        return false;
+    }
+
+    usedBytes += bytes;
+    peakBytes = std::max(peakBytes, usedBytes);
+    return true;
+}
+
+void ByteBudget::release(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        usedBytes -= std::min(bytes, usedBytes);
+    }
+    released.notify_all();
+}
+
+void ByteBudget::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    released.notify_all();
+}
+
+size_t ByteBudget::getPeakBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return peakBytes;
+}
@@ -0,0 +1,34 @@
+#ifndef BYTE_BUDGET_H
+#define BYTE_BUDGET_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// Limits how many bytes are held at once across threads. A request larger than the whole
+// budget is still let through when nothing else is held, so it cannot wait forever.
+class ByteBudget {
+public:
+    explicit ByteBudget(size_t maxBytes);
+
+    // Blocks until the bytes fit. Returns false if the budget was closed while waiting.
+    bool acquire(size_t bytes);
+    void release(size_t bytes);
+    void close();
+    size_t getPeakBytes() const;
+
+private:
+    ByteBudget(const ByteBudget&) = delete;
+    ByteBudget& operator=(const ByteBudget&) = delete;
+
+private:
+    size_t maxBytes;
+    size_t usedBytes;
+    size_t peakBytes;
+    mutable std::mutex mutex;
+    std::condition_variable released;
+    bool closed;
+
+};
+
+#endif // BYTE_BUDGET_H
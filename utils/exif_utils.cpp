@@ -0,0 +1,83 @@
+#include "exif_utils.h"
+#include <cstdint>
+#include <vector>
+
+const uint16_t TIFF_MAGIC = 42;
+const uint16_t TAG_EXIF_IFD_POINTER = 0x8769;
+const uint16_t TAG_DATE_TIME_ORIGINAL = 0x9003;
+const uint16_t TAG_OFFSET_TIME_ORIGINAL = 0x9011;
+const uint16_t TYPE_ASCII = 2;
+const uint16_t TYPE_LONG = 4;
+const uint32_t TIFF_HEADER_SIZE = 8;
+const uint32_t IFD_ENTRY_SIZE = 12;
+
+namespace {
+
+    struct AsciiTag {
+        uint16_t tag;
+        std::string value;
+    };
+
+    void appendShort(std::string& data, uint16_t value) {
+        data += (char) (value >> 8);
+        data += (char) (value & 0xFF);
+    }
+
+    void appendLong(std::string& data, uint32_t value) {
+        appendShort(data, value >> 16);
+        appendShort(data, value & 0xFFFF);
+    }
+
+    uint32_t ifdSize(uint32_t entryCount) {
+        return 2 + entryCount * IFD_ENTRY_SIZE + 4;
+    }
+
+}
+
+std::string ExifUtils::buildOriginalDateExif(const std::string& timestamp, const std::string& offset) {
+    // Tags within an IFD have to be sorted by tag number
+    const std::vector<AsciiTag> exifTags = {
+        {TAG_DATE_TIME_ORIGINAL, timestamp},
+        {TAG_OFFSET_TIME_ORIGINAL, offset}
+    };
+
+    const uint32_t exifIfdOffset = TIFF_HEADER_SIZE + ifdSize(1);
+    const uint32_t valueOffset = exifIfdOffset + ifdSize(exifTags.size());
+
+    std::string exif = "MM";
+    appendShort(exif, TIFF_MAGIC);
+    appendLong(exif, TIFF_HEADER_SIZE);
+
+    // IFD0 only points at the Exif IFD
+    appendShort(exif, 1);
+    appendShort(exif, TAG_EXIF_IFD_POINTER);
+    appendShort(exif, TYPE_LONG);
+    appendLong(exif, 1);
+    appendLong(exif, exifIfdOffset);
+    appendLong(exif, 0);
+
+    std::string values;
+    appendShort(exif, exifTags.size());
+    for (const AsciiTag& tag : exifTags) {
+        // ASCII counts include the terminating NUL, and values of four bytes or less are stored inline
+        std::string value = tag.value + '\0';
+        appendShort(exif, tag.tag);
+        appendShort(exif, TYPE_ASCII);
+        appendLong(exif, value.size());
+
+        if (value.size() <= 4) {
+            exif += value + std::string(4 - value.size(), '\0');
+        } else {
+            appendLong(exif, valueOffset + values.size());
+            values += value;
+
+            // Offsets to values must be word aligned
+            if (values.size() % 2 != 0) {
+                values += '\0';
+            }
+        }
+    }
+    appendLong(exif, 0);
+
+    return exif + values;
+}
@@ -0,0 +1,13 @@
+#ifndef EXIF_UTILS_H
+#define EXIF_UTILS_H
+
+#include <string>
+
+namespace ExifUtils {
+
+    // Minimal big-endian TIFF block holding DateTimeOriginal and OffsetTimeOriginal, ready for a PNG eXIf chunk
+    std::string buildOriginalDateExif(const std::string& timestamp, const std::string& offset);
+
+}
+
+#endif // EXIF_UTILS_H
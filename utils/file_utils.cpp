@@ -52,6 +52,15 @@ std::optional<std::string> FileUtils::readFile(const std::string& imagePath, con
     return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 }
 
+void FileUtils::writeFile(const std::string& filename, const std::string& data) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Unable to open file for writing: " + filename);
+    }
+
+    file.write(data.data(), data.size());
+}
+
 std::string FileUtils::getExecutableDirectory() {
     #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
         char path[MAX_PATH];
@@ -10,6 +10,7 @@ namespace FileUtils {
     void setCurrentPath(const std::string& path);
     bool fileExists(const std::string& filename);
     std::optional<std::string> readFile(const std::string& imagePath, const std::string& filename);
+    void writeFile(const std::string& filename, const std::string& data);
     std::string getExecutableDirectory();
     void updateExifOriginalDate(const std::string& filename, const std::string& timestamp, const std::string& offset);
 
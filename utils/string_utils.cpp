@@ -47,3 +47,54 @@ bool StringUtils::isAllUppercaseLetters(const std::string& text) {
     }
     return true;
 }
+
+std::u32string StringUtils::decodeUtf8(const std::string& text) {
+    std::u32string codepoints;
+    codepoints.reserve(text.length());
+
+    size_t i = 0;
+    while (i < text.length()) {
+        unsigned char lead = text[i];
+        int continuationBytes = 0;
+        char32_t codepoint = lead;
+
+        if ((lead & 0xE0) == 0xC0) {
+            continuationBytes = 1;
+            codepoint = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            continuationBytes = 2;
+            codepoint = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            continuationBytes = 3;
+            codepoint = lead & 0x07;
+        }
+
+        // Malformed sequences fall back to treating the lead byte as Latin-1
+        if (i + continuationBytes >= text.length()) {
+            codepoints.push_back(lead);
+            i++;
+            continue;
+        }
+
+        bool valid = true;
+        for (int j = 1; j <= continuationBytes; j++) {
+            unsigned char next = text[i + j];
+            if ((next & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+            codepoint = (codepoint << 6) | (next & 0x3F);
+        }
+
+        if (!valid) {
+            codepoints.push_back(lead);
+            i++;
+            continue;
+        }
+
+        codepoints.push_back(codepoint);
+        i += continuationBytes + 1;
+    }
+
+    return codepoints;
+}
@@ -11,6 +11,7 @@ namespace StringUtils {
     std::vector<std::string> split(const std::string& str, const char delimiter);
     bool stringContainsElement(const std::string& str, const std::string elements);
     bool isAllUppercaseLetters(const std::string& text);
+    std::u32string decodeUtf8(const std::string& text);
 
 }
 
@@ -0,0 +1,40 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+public:
+    // A thread count of 0 uses one thread per hardware core
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> submit(Function&& function);
+
+    unsigned int getThreadCount() const;
+
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    void workerLoop();
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    bool stopping;
+
+};
+
+#include "thread_pool.tpp"
+
+#endif // THREAD_POOL_H
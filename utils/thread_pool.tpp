@@ -0,0 +1,22 @@
+#include <memory>
+#include <stdexcept>
+
+// The returned future rethrows anything the function throws
+template <typename Function>
+std::future<std::invoke_result_t<Function>> ThreadPool::submit(Function&& function) {
+    using Result = std::invoke_result_t<Function>;
+
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+    std::future<Result> result = task->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            throw std::runtime_error("Cannot submit work to a stopped thread pool.");
+        }
+        tasks.push([task]() { (*task)(); });
+    }
+    taskAvailable.notify_one();
+
+    return result;
+}